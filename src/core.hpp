@@ -116,7 +116,9 @@ struct alc {
 
   let alc() noexcept : ptr(nil), kind(Kind::Nil) {}
 
-  let alc(Arena* arena) noexcept
+  // Arena kind is backed by coven::mem::Arena, which remembers its most
+  // recent allocation. That chunk is grown and released in place
+  let alc(coven::mem::Arena* arena) noexcept
       : ptr(cast(anyptr, arena)), kind(Kind::Arena) {}
 
   let alc(Gen* gen) noexcept : ptr(cast(anyptr, gen)), kind(Kind::Gen) {}
@@ -130,7 +132,8 @@ struct alc {
       }
 
       case Kind::Arena: {
-        noimp();
+        var coven::mem::Arena* arena = cast(coven::mem::Arena*, ptr);
+        return arena->alloc(n);
       }
 
       case Kind::Gen: {
@@ -153,7 +156,9 @@ struct alc {
       }
 
       case Kind::Arena: {
-        noimp();
+        // last allocation of arena is grown in place
+        var coven::mem::Arena* arena = cast(coven::mem::Arena*, ptr);
+        return arena->realloc(c, n);
       }
 
       case Kind::Gen: {
@@ -176,7 +181,9 @@ struct alc {
       }
 
       case Kind::Arena: {
-        noimp();
+        var coven::mem::Arena* arena = cast(coven::mem::Arena*, ptr);
+        arena->free(c);
+        return;
       }
 
       case Kind::Gen: {
@@ -221,17 +228,25 @@ fn internal inline usz determine_bytes_grow_amount(usz cap, usz len) noexcept {
   return len + (len >> 1);
 }
 
-// Dynamically allocated bytes buffer. Default global general
-// purpose allocator is used to manage underlying memory
+// Dynamically allocated bytes buffer. Memory is managed by supplied
+// allocator, default global general purpose allocator is used when
+// allocator is nil
 struct DynBytesBuffer {
   bb buf;
 
-  let DynBytesBuffer() noexcept : buf(bb()) {}
+  // Allocator used to pull/release memory for buffer
+  mem::alc alc;
+
+  let DynBytesBuffer() noexcept : buf(bb()), alc(mem::alc()) {}
 
-  let DynBytesBuffer(usz n) noexcept : buf(bb()) { init(n); }
+  let DynBytesBuffer(usz n) noexcept : buf(bb()), alc(mem::alc()) { init(n); }
+
+  let DynBytesBuffer(mem::alc a) noexcept : buf(bb()), alc(a) {}
+
+  let DynBytesBuffer(mem::alc a, usz n) noexcept : buf(bb()), alc(a) { init(n); }
 
   // Allocates a dynamic copy of a given memory chunk
-  let DynBytesBuffer(mc c) noexcept : buf(bb()) {
+  let DynBytesBuffer(mc c) noexcept : buf(bb()), alc(mem::alc()) {
     if (c.is_nil()) {
       return;
     }
@@ -243,11 +258,18 @@ struct DynBytesBuffer {
     if (n == 0) {
       return;
     }
-    buf = bb(mem::alloc(n));
+    buf = bb(alloc(n));
   }
 
   method bool is_nil() const noexcept { return buf.is_nil(); }
 
+  method mc alloc(usz n) noexcept {
+    if (alc.is_nil()) {
+      return mem::alloc(n);
+    }
+    return alc.alloc(n);
+  }
+
   // Increase buffer capacity by at least n bytes
   method void grow(usz n) noexcept {
     if (n == 0) {
@@ -255,13 +277,17 @@ struct DynBytesBuffer {
     }
 
     if (buf.is_nil()) {
-      buf = bb(mem::alloc(n));
+      buf = bb(alloc(n));
       return;
     }
 
     const usz len = buf.len;
 
-    buf = bb(mem::realloc(buf.body(), buf.cap + n));
+    if (alc.is_nil()) {
+      buf = bb(mem::realloc(buf.body(), buf.cap + n));
+    } else {
+      buf = bb(alc.realloc(buf.body(), buf.cap + n));
+    }
     buf.len = len;
   }
 
@@ -335,7 +361,11 @@ struct DynBytesBuffer {
     if (buf.is_nil()) {
       return;
     }
-    mem::free(buf.body());
+    if (alc.is_nil()) {
+      mem::free(buf.body());
+      return;
+    }
+    alc.free(buf.body());
   }
 
   method void reset() noexcept { buf.reset(); }
@@ -31,6 +31,19 @@ fn internal inline constexpr u64 trailing_zeros(u64 x) noexcept {
   return __builtin_ctzl(x);
 }
 
+fn internal inline constexpr u64 leading_zeros(u64 x) noexcept {
+  if (x == 0) {
+    return 64;
+  }
+
+  return __builtin_clzl(x);
+}
+
+// Returns number of bits set to 1
+fn internal inline constexpr u32 pop_count(u32 x) noexcept {
+  return cast(u32, __builtin_popcount(x));
+}
+
 fn internal inline constexpr bool is_power_of_2(u32 x) noexcept {
   return (x & (x - 1)) == 0;
 }
@@ -58,8 +71,14 @@ fn internal inline constexpr uarch align_by_16(uarch x) noexcept {
 }
 
 fn internal inline constexpr uarch align_by_4kb(uarch x) noexcept {
-  var uarch a = x & 0x3FF;
-  a = ((~a) + 1) & 0x3FF;
+  var uarch a = x & 0xFFF;
+  a = ((~a) + 1) & 0xFFF;
+  return x + a;
+}
+
+fn internal inline constexpr uarch align_by_2mb(uarch x) noexcept {
+  var uarch a = x & 0x1FFFFF;
+  a = ((~a) + 1) & 0x1FFFFF;
   return x + a;
 }
 
@@ -151,18 +151,14 @@ method void mc::clear() noexcept {
   must(len != 0);
   must(ptr != nil);
 
-  for (uarch i = 0; i < len; i += 1) {
-    ptr[i] = 0;
-  }
+  mem::fill(ptr, 0, len);
 }
 
 method void mc::fill(u8 x) noexcept {
   must(len != 0);
   must(ptr != nil);
 
-  for (uarch i = 0; i < len; i += 1) {
-    ptr[i] = x;
-  }
+  mem::fill(ptr, x, len);
 }
 
 // Alias for code documentation of intented memory chunk meaning
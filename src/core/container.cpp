@@ -1,5 +1,54 @@
 namespace coven::cont {
 
+// Number of key bytes stored inside FlatMap entry. Longer keys
+// are stored partially
+internal const uarch flat_map_key_size = 16;
+
+// Alignment of FlatMap entries storage
+internal const uarch flat_map_align = 64;
+
+// Alignment of FlatMap entry with given item type. Entries which fit
+// into half of a cache line are aligned by 32 bytes, bigger ones take
+// whole cache line
+template <typename I>
+fn internal inline constexpr uarch flat_map_entry_align() noexcept {
+  struct Body {
+    u8 key[flat_map_key_size];
+    u64 hash;
+    u32 len;
+    I item;
+  };
+  return sizeof(Body) <= 32 ? 32 : 64;
+}
+
+// Returns true if n bytes at p equal first n bytes stored in entry
+// key and the rest of stored bytes are zero. Key is compared as a whole
+// with one vector comparison, thus n must not exceed key size
+//
+// Input is read with a single 16-byte load, unless that would cross
+// page boundary. Bytes beyond n are masked out
+fn internal inline bool flat_map_key_equal(const u8* stored, const u8* p, uarch n) noexcept {
+  const uarch page_size = 1 << 12;
+
+  var mem::u8x16 v dirty;
+  if ((cast(uptr, p) & (page_size - 1)) <= page_size - flat_map_key_size) {
+    v = *cast(const mem::u8x16*, p);
+  } else {
+    var u8 buf[flat_map_key_size] = {};
+    for (uarch i = 0; i < n; i += 1) {
+      buf[i] = p[i];
+    }
+    v = *cast(const mem::u8x16*, buf);
+  }
+
+  const mem::u8x16 index = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  v &= cast(mem::u8x16, index < cast(u8, n));
+
+  const mem::u8x16 k = *cast(const mem::u8x16*, stored);
+  const mem::u8x16 m = cast(mem::u8x16, v == k);
+  return __builtin_ia32_pmovmskb128(cast(mem::c8x16, m)) == 0xFFFF;
+}
+
 // Hash table of static size with no collisions. This is achived
 // by handpicking starting seed for hash function
 template <typename T>
@@ -23,18 +72,25 @@ struct FlatMap {
     bool ok;
 
     // constructs empty item
-    let Item() noexcept : value(T()), ok(false) {}
+    let constexpr Item() noexcept : value(T()), ok(false) {}
 
-    let Item(T v) noexcept : value(v), ok(true) {}
+    let constexpr Item(T v) noexcept : value(v), ok(true) {}
   };
 
   // Internal structure used for storing items in map
-  struct Entry {
+  //
+  // Entries occupy 32 or 64 bytes (depending on size of T) and are
+  // aligned by their size, thus probing a slot touches exactly one
+  // cache line
+  struct alignas(flat_map_entry_align<Item>()) Entry {
+    // first bytes of stored key padded with zeroes
+    u8 key[flat_map_key_size];
+
     // key hash of stored item
     u64 hash;
 
     // key length of stored item
-    uarch len;
+    u32 len;
 
     Item item;
   };
@@ -42,6 +98,9 @@ struct FlatMap {
   // continuous chunk of stored entries
   chunk<Entry> entries;
 
+  // Memory allocated for entries. Nil if map does not own them
+  mc block;
+
   u64 mask;
 
   u64 seed;
@@ -57,6 +116,7 @@ struct FlatMap {
 
   let FlatMap() noexcept
       : entries(chunk<Entry>()),
+        block(),
         mask(0),
         seed(0),
         len(0),
@@ -65,6 +125,7 @@ struct FlatMap {
 
   let FlatMap(uarch cap, u64 m, u64 s) noexcept
       : entries(chunk<Entry>(nil, cap)),
+        block(),
         mask(m),
         seed(s),
         len(0),
@@ -74,16 +135,41 @@ struct FlatMap {
     init();
   }
 
+  // Create map over cap entries which were populated ahead of time, for
+  // example by a header generated with flatfit tool. Entries are usually
+  // placed in read-only memory, thus such map must only be used for
+  // lookups. It does not own its entries and must not be freed
+  let FlatMap(const Entry* e, uarch cap, u64 s, uarch n, uarch min_len, uarch max_len) noexcept
+      : entries(chunk<Entry>(cast(Entry*, e), cap)),
+        block(),
+        mask(cap - 1),
+        seed(s),
+        len(n),
+        min_key_len(min_len),
+        max_key_len(max_len) {
+    must(bits::is_power_of_2(cap));
+  }
+
   method void init() noexcept {
     const uarch cap = entries.len;
-    entries = mem::calloc<Entry>(cap);
+    block = mem::calloc(cap * sizeof(Entry) + flat_map_align);
+
+    const uptr p = (cast(uptr, block.ptr) + flat_map_align - 1) & ~(flat_map_align - 1);
+    entries = chunk<Entry>(cast(Entry*, p), cap);
   }
 
   method bool is_nil() noexcept { return entries.is_nil(); }
 
   method bool is_empty() noexcept { return len == 0; }
 
-  method void free() noexcept { mem::free(entries); }
+  method void free() noexcept {
+    if (block.is_nil()) {
+      return;
+    }
+    mem::free(block);
+    block = mc();
+    entries = chunk<Entry>();
+  }
 
   method u64 hash(str key) noexcept { return hash::map::compute(seed, key); }
 
@@ -102,11 +188,13 @@ struct FlatMap {
       return false;
     }
 
-    entries.ptr[pos] = {
-        .hash = h,
-        .len = key.len,
-        .item = Item(value),
-    };
+    var Entry* e = entries.ptr + pos;
+    e->hash = h;
+    e->len = cast(u32, key.len);
+    e->item = Item(value);
+    for (uarch i = 0; i < min(key.len, flat_map_key_size); i += 1) {
+      e->key[i] = key.ptr[i];
+    }
 
     if (key.len > max_key_len) {
       max_key_len = key.len;
@@ -132,13 +220,19 @@ struct FlatMap {
 
     const uarch h = hash(key);
     const uarch pos = determine_pos(h);
-    const Entry entry = entries.ptr[pos];
+    const Entry* e = entries.ptr + pos;
 
-    if (!entry.item.ok || entry.len != key.len || entry.hash != h) {
+    if (!e->item.ok || e->len != key.len || e->hash != h) {
       return Item();
     }
 
-    return entry.item;
+    // keys longer than stored part are confirmed by their
+    // prefix, length and full hash
+    if (!flat_map_key_equal(e->key, key.ptr, min(key.len, flat_map_key_size))) {
+      return Item();
+    }
+
+    return e->item;
   }
 
   method void clear() noexcept {
@@ -233,6 +327,568 @@ fn FlatMap<T> fit_into_flat_map(
   return FlatMap<T>();
 }
 
+// Maximum length of key stored in StaticMap. Keys are stored
+// inside map entries, thus lookups do not chase pointers
+internal const uarch static_map_key_size = flat_map_key_size;
+
+// Number of seeds tried for each capacity before moving on
+// to the next (twice bigger) one
+internal const u64 static_map_seed_budget = 1 << 12;
+
+// Key-value pair for building StaticMap at compile time
+template <typename T>
+struct StaticPair {
+  const char* key;
+  T value;
+};
+
+// Capacity and hash seed of perfect hash table
+struct StaticMapShape {
+  uarch cap;
+  u64 seed;
+};
+
+fn internal inline constexpr uarch static_key_len(const char* s) noexcept {
+  var uarch n = 0;
+  while (s[n] != 0) {
+    n += 1;
+  }
+  return n;
+}
+
+// Returns true if all keys land in distinct slots of table with cap
+// slots when hashed with given seed
+template <typename T, uarch N>
+fn internal constexpr bool static_map_fits(const StaticPair<T> (&pairs)[N], uarch cap, u64 seed) noexcept {
+  var uarch pos[N] = {};
+  for (uarch i = 0; i < N; i += 1) {
+    const char* key = pairs[i].key;
+    pos[i] = hash::word::compute(seed, key, static_key_len(key)) & (cap - 1);
+    for (uarch j = 0; j < i; j += 1) {
+      if (pos[j] == pos[i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns first seed which places all keys into distinct slots of
+// table with cap slots. Returns seed budget if there is no such seed
+template <typename T, uarch N>
+fn internal constexpr u64 static_map_seed(const StaticPair<T> (&pairs)[N], uarch cap) noexcept {
+  for (u64 seed = 0; seed < static_map_seed_budget; seed += 1) {
+    if (static_map_fits(pairs, cap, seed)) {
+      return seed;
+    }
+  }
+  return static_map_seed_budget;
+}
+
+// Finds smallest table (starting from twice number of keys) for which
+// a perfect hash seed can be found quickly
+template <typename T, uarch N>
+fn internal constexpr StaticMapShape fit_static_map(const StaticPair<T> (&pairs)[N]) noexcept {
+  var uarch cap = 1;
+  while (cap < 2 * N) {
+    cap <<= 1;
+  }
+
+  while (true) {
+    const u64 seed = static_map_seed(pairs, cap);
+    if (seed != static_map_seed_budget) {
+      return StaticMapShape{.cap = cap, .seed = seed};
+    }
+    cap <<= 1;
+  }
+}
+
+// Hash table with no collisions for a fixed set of keys, which is
+// built entirely at compile time. Lookup takes a single probe followed
+// by comparison of key bytes, thus unlike FlatMap it never reports
+// a hit for a key which was not placed into map
+//
+// Table capacity C is picked by fit_static_map, use StaticMapOf
+// to obtain type of map for particular set of keys:
+//
+//   internal constexpr cont::StaticPair<u32> pairs[] = {{"foo", 1}, {"bar", 2}};
+//   internal constexpr cont::StaticMapOf<pairs> map = cont::StaticMapOf<pairs>(pairs);
+template <typename T, uarch C>
+struct StaticMap {
+  // Item stored in map. Returned when get method is used
+  struct Item {
+    T value;
+
+    // true if key is present in map
+    bool ok;
+
+    let Item() noexcept : value(T()), ok(false) {}
+
+    let Item(T v) noexcept : value(v), ok(true) {}
+  };
+
+  // Aligned in the same way as FlatMap entries, probe
+  // touches only one cache line
+  struct alignas(32) Entry {
+    // Key bytes padded with zeroes
+    u8 key[static_map_key_size];
+
+    // Key length, zero for empty entry
+    u8 len;
+
+    T value;
+  };
+
+  Entry entries[C];
+
+  u64 seed;
+
+  // minimal length of key stored in map
+  uarch min_key_len;
+
+  // maximum length of key stored in map
+  uarch max_key_len;
+
+  // Keys which are empty or longer than static_map_key_size, as well
+  // as duplicate keys, make map construction fail at compile time
+  template <uarch N>
+  let constexpr StaticMap(const StaticPair<T> (&pairs)[N]) noexcept
+      : entries(), seed(static_map_seed(pairs, C)), min_key_len(static_map_key_size), max_key_len(0) {
+    must(seed != static_map_seed_budget);
+
+    for (uarch i = 0; i < C; i += 1) {
+      entries[i] = Entry{};
+    }
+
+    for (uarch i = 0; i < N; i += 1) {
+      const char* key = pairs[i].key;
+      const uarch len = static_key_len(key);
+      must(len != 0 && len <= static_map_key_size);
+
+      var Entry& e = entries[hash::word::compute(seed, key, len) & (C - 1)];
+      must(e.len == 0);
+
+      for (uarch j = 0; j < len; j += 1) {
+        e.key[j] = cast(u8, key[j]);
+      }
+      e.len = cast(u8, len);
+      e.value = pairs[i].value;
+
+      min_key_len = min(min_key_len, len);
+      max_key_len = max(max_key_len, len);
+    }
+  }
+
+  method Item get(str key) const noexcept {
+    if (key.len < min_key_len || key.len > max_key_len) {
+      return Item();
+    }
+
+    const Entry& e = entries[hash::word::compute(seed, key.ptr, key.len) & (C - 1)];
+    if (e.len != key.len || !flat_map_key_equal(e.key, key.ptr, key.len)) {
+      return Item();
+    }
+    return Item(e.value);
+  }
+};
+
+// Type of StaticMap which holds given set of pairs
+template <auto& pairs>
+using StaticMapOf = StaticMap<decltype(pairs[0].value), fit_static_map(pairs).cap>;
+
+// Control byte values of HashMap slots. Occupied slot stores lower 7 bits
+// of its key hash in control byte, thus most mismatches are rejected
+// without comparing keys. Only empty and deleted slots have highest bit set
+internal const u8 hash_map_ctrl_empty = 0x80;
+internal const u8 hash_map_ctrl_deleted = 0xFE;
+
+// Number of control bytes examined at once during probing
+internal const uarch hash_map_group_size = 16;
+
+internal const uarch hash_map_min_cap = 16;
+
+// Returns bit mask of positions in group where control byte equals x
+fn internal inline u32 hash_map_match(const u8* ctrl, u8 x) noexcept {
+  const mem::u8x16 v = *cast(const mem::u8x16*, ctrl);
+  const mem::u8x16 m = cast(mem::u8x16, v == (mem::u8x16{} + x));
+  return cast(u32, __builtin_ia32_pmovmskb128(cast(mem::c8x16, m)));
+}
+
+// Returns bit mask of positions in group with empty or deleted slots
+fn internal inline u32 hash_map_match_free(const u8* ctrl) noexcept {
+  const mem::u8x16 v = *cast(const mem::u8x16*, ctrl);
+  return cast(u32, __builtin_ia32_pmovmskb128(cast(mem::c8x16, v)));
+}
+
+// Maximum number of occupied and deleted slots in map of given capacity,
+// which keeps load factor at 7/8
+fn internal inline constexpr uarch hash_map_growth(uarch cap) noexcept {
+  return cap - (cap >> 3);
+}
+
+// Returns smallest capacity of map which can hold n entries
+fn internal inline constexpr uarch hash_map_cap_for(uarch n) noexcept {
+  var uarch cap = hash_map_min_cap;
+  while (hash_map_growth(cap) < n) {
+    cap <<= 1;
+  }
+  return cap;
+}
+
+// Map is never stored between runs, thus it uses the fastest hash
+// available on the processor
+fn internal inline u64 hash_map_key_hash(u64 seed, str key) noexcept {
+  return hash::native::compute(seed, key);
+}
+
+// Integer keys are hashed by their memory representation
+template <typename K>
+fn internal inline u64 hash_map_key_hash(u64 seed, K key) noexcept {
+  return hash::native::compute(seed, mc(cast(u8*, &key), sizeof(K)));
+}
+
+fn internal inline bool hash_map_key_equal(str a, str b) noexcept {
+  return cmp::equal(a, b);
+}
+
+template <typename K>
+fn internal inline bool hash_map_key_equal(K a, K b) noexcept {
+  return a == b;
+}
+
+// Growable hash table with open addressing. Keys may be strings or
+// integers, map does not copy string keys, memory they point to must
+// outlive the map
+//
+// Each slot has a control byte, control bytes are stored separately from
+// entries and are probed in groups of 16 with SSE2 instructions. Control
+// bytes of the first group are mirrored after the last slot, thus group
+// starting at any slot can be loaded without wrapping around
+//
+// Allocator type A must provide alloc and free methods which operate
+// on memory chunks, e.g. mem::Heap or mem::Arena. Default constructed
+// map uses global heap, maps with other allocator types must be given
+// an allocator explicitly
+template <typename K, typename V, typename A = mem::Heap>
+struct HashMap {
+  struct Entry {
+    K key;
+    V value;
+  };
+
+  // Item stored in map. Returned when get method is used
+  struct Item {
+    V value;
+
+    // true if key is present in map
+    bool ok;
+
+    let Item() noexcept : value(V()), ok(false) {}
+
+    let Item(V v) noexcept : value(v), ok(true) {}
+  };
+
+  // Result of insert method
+  struct Slot {
+    // Points to value stored for the key inside map. Remains valid
+    // until next insertion or map destruction
+    V* value;
+
+    // true if key was not present in map before insertion
+    bool added;
+  };
+
+  // Memory holding control bytes followed by entries
+  mc block;
+
+  // Control bytes, cap + 16 of them
+  u8* ctrl;
+
+  Entry* entries;
+
+  // Number of slots in map, always a power of 2 (or 0 for nil map)
+  uarch cap;
+
+  // number of entries stored in map
+  uarch len;
+
+  // Number of empty slots which can be occupied before map must grow
+  uarch growth_left;
+
+  u64 seed;
+
+  A* alc;
+
+  let HashMap() noexcept : HashMap(default_allocator<A>()) {}
+
+  let HashMap(A* a) noexcept
+      : block(), ctrl(nil), entries(nil), cap(0), len(0), growth_left(0), seed(0), alc(a) {}
+
+  let HashMap(A* a, uarch n) noexcept : HashMap(a) { reserve(n); }
+
+  method bool is_nil() const noexcept { return cap == 0; }
+
+  method bool is_empty() const noexcept { return len == 0; }
+
+  method void free() noexcept {
+    if (is_nil()) {
+      return;
+    }
+    alc->free(block);
+    block = mc();
+    ctrl = nil;
+    entries = nil;
+    cap = 0;
+    len = 0;
+    growth_left = 0;
+  }
+
+  // Remove all entries, keeping allocated memory
+  method void clear() noexcept {
+    if (is_nil()) {
+      return;
+    }
+    mem::fill(ctrl, hash_map_ctrl_empty, cap + hash_map_group_size);
+    len = 0;
+    growth_left = hash_map_growth(cap);
+  }
+
+  // Grow map (if needed) to hold at least n entries without
+  // further allocations
+  method void reserve(uarch n) noexcept {
+    const uarch c = hash_map_cap_for(n);
+    if (c <= cap && n <= len + growth_left) {
+      return;
+    }
+    rehash(c > cap ? c : cap);
+  }
+
+  // Returns pointer to value stored for the key or nil
+  // if there is no such key in map
+  method V* find(K key) const noexcept {
+    if (len == 0) {
+      return nil;
+    }
+
+    const uarch i = locate(key, hash_map_key_hash(seed, key));
+    if (i == cap) {
+      return nil;
+    }
+    return &entries[i].value;
+  }
+
+  method Item get(K key) const noexcept {
+    const V* v = find(key);
+    if (v == nil) {
+      return Item();
+    }
+    return Item(*v);
+  }
+
+  method bool has(K key) const noexcept { return find(key) != nil; }
+
+  // Find slot for the key, adding key to map if it is not present yet.
+  // Value of newly added entry is default constructed
+  method Slot insert(K key) noexcept {
+    const u64 h = hash_map_key_hash(seed, key);
+    if (len != 0) {
+      const uarch i = locate(key, h);
+      if (i != cap) {
+        return Slot{.value = &entries[i].value, .added = false};
+      }
+    }
+
+    if (is_nil()) {
+      rehash(hash_map_min_cap);
+    }
+
+    var uarch i = find_free(h);
+    if (growth_left == 0 && ctrl[i] == hash_map_ctrl_empty) {
+      grow();
+      i = find_free(h);
+    }
+    if (ctrl[i] == hash_map_ctrl_empty) {
+      growth_left -= 1;
+    }
+
+    set_ctrl(i, tag(h));
+    entries[i] = Entry{.key = key, .value = V()};
+    len += 1;
+    return Slot{.value = &entries[i].value, .added = true};
+  }
+
+  // Store value for the key, replacing previous one if key
+  // is already present in map
+  method void set(K key, V value) noexcept { *insert(key).value = value; }
+
+  // Returns true if entry was added to map. Returns false
+  // if key is already present in map, stored value is not
+  // changed in that case
+  method bool add(K key, V value) noexcept {
+    const Slot s = insert(key);
+    if (!s.added) {
+      return false;
+    }
+    *s.value = value;
+    return true;
+  }
+
+  // Returns true if key was present in map
+  method bool remove(K key) noexcept {
+    if (len == 0) {
+      return false;
+    }
+
+    const uarch i = locate(key, hash_map_key_hash(seed, key));
+    if (i == cap) {
+      return false;
+    }
+
+    // Slot can be marked empty only if probing never passed over
+    // a full group around it, otherwise lookups of other keys which
+    // were placed after this slot would stop early
+    const uarch before = (i - hash_map_group_size) & (cap - 1);
+    const u32 empty_after = hash_map_match(ctrl + i, hash_map_ctrl_empty);
+    const u32 empty_before = hash_map_match(ctrl + before, hash_map_ctrl_empty);
+    const uarch gap = bits::trailing_zeros(empty_after) + bits::leading_zeros(cast(u64, empty_before)) - 48;
+    if (empty_after != 0 && empty_before != 0 && gap < hash_map_group_size) {
+      set_ctrl(i, hash_map_ctrl_empty);
+      growth_left += 1;
+    } else {
+      set_ctrl(i, hash_map_ctrl_deleted);
+    }
+
+    len -= 1;
+    return true;
+  }
+
+  // Returns index of first occupied slot at or after position i.
+  // Returns cap when there are no more occupied slots. Intended
+  // for iterating over map entries:
+  //
+  //   for (uarch i = m.next(0); i < m.cap; i = m.next(i + 1)) {
+  //     use(m.entries[i]);
+  //   }
+  method uarch next(uarch i) const noexcept {
+    for (; i < cap; i += 1) {
+      if ((ctrl[i] & 0x80) == 0) {
+        return i;
+      }
+    }
+    return cap;
+  }
+
+  method u8 tag(u64 h) const noexcept { return cast(u8, h & 0x7F); }
+
+  method uarch start_pos(u64 h) const noexcept { return cast(uarch, h >> 7) & (cap - 1); }
+
+  method void set_ctrl(uarch i, u8 c) noexcept {
+    ctrl[i] = c;
+    if (i < hash_map_group_size) {
+      ctrl[cap + i] = c;
+    }
+  }
+
+  // Returns index of slot holding the key or cap if key is not
+  // present in map
+  //
+  // Groups are probed in quadratic sequence, which visits every
+  // group exactly once when number of slots is a power of 2
+  method uarch locate(K key, u64 h) const noexcept {
+    const uarch mask = cap - 1;
+    const u8 t = tag(h);
+
+    var uarch pos = start_pos(h);
+    var uarch step = 0;
+    while (true) {
+      var u32 m = hash_map_match(ctrl + pos, t);
+      while (m != 0) {
+        const uarch i = (pos + bits::trailing_zeros(m)) & mask;
+        if (hash_map_key_equal(entries[i].key, key)) {
+          return i;
+        }
+        m &= m - 1;
+      }
+
+      if (hash_map_match(ctrl + pos, hash_map_ctrl_empty) != 0) {
+        return cap;
+      }
+
+      step += hash_map_group_size;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  // Returns index of the first empty or deleted slot in probe
+  // sequence of hash h. Map always has at least one empty slot
+  method uarch find_free(u64 h) const noexcept {
+    const uarch mask = cap - 1;
+
+    var uarch pos = start_pos(h);
+    var uarch step = 0;
+    while (true) {
+      const u32 m = hash_map_match_free(ctrl + pos);
+      if (m != 0) {
+        return (pos + bits::trailing_zeros(m)) & mask;
+      }
+
+      step += hash_map_group_size;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  // Make room for at least one more entry. When most of used up growth
+  // was taken by deleted slots, map is rebuilt with the same capacity
+  method void grow() noexcept {
+    if (len <= hash_map_growth(cap) / 2) {
+      rehash(cap);
+      return;
+    }
+    rehash(cap << 1);
+  }
+
+  // Move all entries into newly allocated table with c slots
+  method void rehash(uarch c) noexcept {
+    must(bits::is_power_of_2(cast(u64, c)));
+    must(c >= hash_map_min_cap);
+    must(hash_map_growth(c) >= len);
+    must(alc != nil);
+
+    const uarch ctrl_size = c + hash_map_group_size;
+    const mc b = alc->alloc(ctrl_size + c * sizeof(Entry));
+    var u8* new_ctrl = b.ptr;
+    var Entry* new_entries = cast(Entry*, b.ptr + ctrl_size);
+    mem::fill(new_ctrl, hash_map_ctrl_empty, ctrl_size);
+
+    const mc old_block = block;
+    const u8* old_ctrl = ctrl;
+    const Entry* old_entries = entries;
+    const uarch old_cap = cap;
+
+    block = b;
+    ctrl = new_ctrl;
+    entries = new_entries;
+    cap = c;
+    growth_left = hash_map_growth(c) - len;
+
+    for (uarch i = 0; i < old_cap; i += 1) {
+      if ((old_ctrl[i] & 0x80) != 0) {
+        continue;
+      }
+
+      const Entry e = old_entries[i];
+      const u64 h = hash_map_key_hash(seed, e.key);
+      const uarch j = find_free(h);
+      set_ctrl(j, tag(h));
+      entries[j] = e;
+    }
+
+    if (old_cap != 0) {
+      alc->free(old_block);
+    }
+  }
+};
+
 template <typename T>
 struct CircularBuffer {
   // Pointer to buffer starting position
@@ -0,0 +1,99 @@
+namespace coven::cpu {
+
+// Processor features which are relevant for selecting between several
+// implementations of the same kernel. Feature is reported only when both
+// processor supports it and operating system saves associated register
+// state on context switch
+struct Features {
+  // SSE4.2 string and CRC32 instructions
+  bool sse42;
+
+  bool popcnt;
+
+  // 256-bit integer vector instructions
+  bool avx2;
+
+  // Bit manipulation instructions: pdep, pext, shlx, bzhi, etc.
+  bool bmi2;
+
+  // 512-bit vector instructions. Set only when foundation, byte/word
+  // and vector length extensions are all present
+  bool avx512;
+
+  // Enhanced rep movsb and rep stosb
+  bool erms;
+
+  // Fast rep movsb for short lengths
+  bool fsrm;
+
+  // AES round instructions
+  bool aes;
+
+  // Carry-less multiplication
+  bool pclmul;
+};
+
+// Implementation levels of vectorized kernels. Each level assumes all
+// features of previous levels are present as well
+enum struct Level : u8 {
+  // Baseline of the platform, SSE2 on amd64
+  Base,
+
+  SSE42,
+  AVX2,
+  AVX512,
+};
+
+internal const uarch level_count = 4;
+
+// Query processor features, implemented separately for each architecture
+fn Features detect() noexcept;
+
+fn internal Level classify(Features f) noexcept {
+  if (f.avx512 && f.avx2 && f.bmi2) {
+    return Level::AVX512;
+  }
+  if (f.avx2 && f.bmi2 && f.sse42 && f.popcnt) {
+    return Level::AVX2;
+  }
+  if (f.sse42 && f.popcnt) {
+    return Level::SSE42;
+  }
+  return Level::Base;
+}
+
+// Features of the processor program runs on. Detected once at startup,
+// before dynamic initialization of any global defined in files which
+// follow this one
+var global const Features detected_features = detect();
+var global const Level detected_level = classify(detected_features);
+
+fn inline const Features& features() noexcept {
+  return detected_features;
+}
+
+// Returns highest kernel implementation level supported by the processor
+fn inline Level level() noexcept {
+  return detected_level;
+}
+
+// Dispatch table with implementations of one kernel for each level.
+// Entries for levels without specialized implementation may be left nil,
+// in that case the closest lower level is used. Entry for base level
+// is mandatory
+template <typename F>
+struct Table {
+  F impls[level_count];
+
+  // Returns best implementation available on the processor
+  method F select() const noexcept {
+    var uarch i = cast(uarch, level());
+    while (impls[i] == nil) {
+      must(i != 0);
+      i -= 1;
+    }
+    return impls[i];
+  }
+};
+
+}  // namespace coven::cpu
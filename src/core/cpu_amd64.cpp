@@ -0,0 +1,87 @@
+namespace coven::cpu {
+
+struct CpuidRegs {
+  u32 a;
+  u32 b;
+  u32 c;
+  u32 d;
+};
+
+fn internal inline CpuidRegs cpuid(u32 leaf, u32 subleaf) noexcept {
+  var CpuidRegs r dirty;
+  asm("cpuid" : "=a"(r.a), "=b"(r.b), "=c"(r.c), "=d"(r.d) : "a"(leaf), "c"(subleaf));
+  return r;
+}
+
+// Returns bits of extended control register 0, which tell which register
+// state components are enabled by operating system
+fn internal inline u64 xgetbv() noexcept {
+  var u32 lo dirty;
+  var u32 hi dirty;
+  asm("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return (cast(u64, hi) << 32) | lo;
+}
+
+// Bits of cpuid leaf 1 in ecx register
+internal const u32 cpuid_sse42_bit = 1 << 20;
+internal const u32 cpuid_popcnt_bit = 1 << 23;
+internal const u32 cpuid_aes_bit = 1 << 25;
+internal const u32 cpuid_pclmul_bit = 1 << 1;
+internal const u32 cpuid_osxsave_bit = 1 << 27;
+internal const u32 cpuid_avx_bit = 1 << 28;
+
+// Bits of cpuid leaf 7 in ebx register
+internal const u32 cpuid_avx2_bit = 1 << 5;
+internal const u32 cpuid_bmi2_bit = 1 << 8;
+internal const u32 cpuid_erms_bit = 1 << 9;
+internal const u32 cpuid_avx512f_bit = 1 << 16;
+internal const u32 cpuid_avx512bw_bit = 1 << 30;
+internal const u32 cpuid_avx512vl_bit = cast(u32, 1) << 31;
+
+// Bit of cpuid leaf 7 in edx register
+internal const u32 cpuid_fsrm_bit = 1 << 4;
+
+// State components in xcr0: xmm and ymm registers
+internal const u64 xcr0_ymm_state = 0x6;
+
+// State components in xcr0: opmask registers and both halves of zmm registers
+internal const u64 xcr0_zmm_state = 0xE0;
+
+fn Features detect() noexcept {
+  var Features f = {};
+
+  const u32 max_leaf = cpuid(0, 0).a;
+  if (max_leaf < 1) {
+    return f;
+  }
+
+  const CpuidRegs r1 = cpuid(1, 0);
+  f.sse42 = (r1.c & cpuid_sse42_bit) != 0;
+  f.popcnt = (r1.c & cpuid_popcnt_bit) != 0;
+  f.aes = (r1.c & cpuid_aes_bit) != 0;
+  f.pclmul = (r1.c & cpuid_pclmul_bit) != 0;
+
+  var u64 xcr0 = 0;
+  if ((r1.c & cpuid_osxsave_bit) != 0) {
+    xcr0 = xgetbv();
+  }
+  const bool ymm = (r1.c & cpuid_avx_bit) != 0 && (xcr0 & xcr0_ymm_state) == xcr0_ymm_state;
+  const bool zmm = ymm && (xcr0 & xcr0_zmm_state) == xcr0_zmm_state;
+
+  if (max_leaf < 7) {
+    return f;
+  }
+
+  const CpuidRegs r7 = cpuid(7, 0);
+  f.avx2 = ymm && (r7.b & cpuid_avx2_bit) != 0;
+  f.bmi2 = (r7.b & cpuid_bmi2_bit) != 0;
+  f.erms = (r7.b & cpuid_erms_bit) != 0;
+  f.fsrm = (r7.d & cpuid_fsrm_bit) != 0;
+
+  const u32 avx512 = cpuid_avx512f_bit | cpuid_avx512bw_bit | cpuid_avx512vl_bit;
+  f.avx512 = zmm && (r7.b & avx512) == avx512;
+
+  return f;
+}
+
+}  // namespace coven::cpu
@@ -25,23 +25,46 @@ fn internal inline uarch determine_grow_amount(uarch cap, uarch len) noexcept {
   return len + (len >> 1);
 }
 
+// Returns global instance of allocator type, if there is one. Buffers
+// with other allocator types must be given an allocator explicitly
+template <typename A>
+fn internal inline A* default_allocator() noexcept {
+  return nil;
+}
+
+template <>
+fn inline mem::Heap* default_allocator<mem::Heap>() noexcept {
+  return &mem::heap;
+}
+
 // Dynamically allocated buffer of elements (of the same type).
 // It is most similar to dynamic arrays from other libraries or
 // languages. Default global general purpose allocator is used
 // to manage underlying memory
-template <typename T>
+//
+// Allocator type A must provide alloc, realloc and free methods
+// which operate on memory chunks, e.g. mem::Heap or mem::Arena
+template <typename T, typename A = mem::Heap>
 struct DynBuffer {
   buffer<T> buf;
 
-  let DynBuffer() noexcept : buf(buffer<T>()) {}
+  // Allocator used to pull/release memory for buffer
+  A* alc;
+
+  let DynBuffer() noexcept : buf(buffer<T>()), alc(default_allocator<A>()) {}
 
-  let DynBuffer(uarch n) noexcept : buf(buffer<T>()) { init(n); }
+  let DynBuffer(uarch n) noexcept : buf(buffer<T>()), alc(default_allocator<A>()) { init(n); }
+
+  let DynBuffer(A* a) noexcept : buf(buffer<T>()), alc(a) {}
+
+  let DynBuffer(A* a, uarch n) noexcept : buf(buffer<T>()), alc(a) { init(n); }
 
   method void init(uarch n) noexcept {
     if (n == 0) {
       return;
     }
-    buf = buffer<T>(mem::alloc<T>(n));
+    must(alc != nil);
+    buf = buffer<T>(elems(alc->alloc(chunk_size(T, n))));
   }
 
   // Increase buffer capacity by at least n elements
@@ -49,18 +72,24 @@ struct DynBuffer {
     if (n == 0) {
       return;
     }
+    must(alc != nil);
 
     if (buf.is_nil()) {
-      buf = buffer<T>(mem::alloc<T>(n));
+      buf = buffer<T>(elems(alc->alloc(chunk_size(T, n))));
       return;
     }
 
     const uarch len = buf.len;
 
-    buf = buffer<T>(mem::realloc<T>(buf.body(), buf.cap + n));
+    buf = buffer<T>(elems(alc->realloc(buf.body().as_mc(), chunk_size(T, buf.cap + n))));
     buf.len = len;
   }
 
+  // Interpret memory chunk received from allocator as chunk of elements
+  method chunk<T> elems(mc c) const noexcept {
+    return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
+  }
+
   method void append(T elem) noexcept {
     if (buf.rem() >= 1) {
       buf.unsafe_append(elem);
@@ -84,7 +113,7 @@ struct DynBuffer {
       return;
     }
 
-    const uarch n = determine_bytes_grow_amount(buf.cap, 1);
+    const uarch n = determine_grow_amount(buf.cap, 1);
     grow(n);
 
     buf.unsafe_insert(i, x);
@@ -103,7 +132,7 @@ struct DynBuffer {
     if (buf.is_nil()) {
       return;
     }
-    mem::free(buf.body());
+    alc->free(buf.body().as_mc());
   }
 
   method void reset() noexcept { buf.reset(); }
@@ -18,34 +18,36 @@ internal const u64 offset = 14695981039346656037ULL;
 internal const u64 prime = 1099511628211;
 
 struct Hasher {
-  u64 sum;
+  // Hash of all bytes written so far
+  u64 state;
 
-  let constexpr Hasher() noexcept : sum(offset) {}
+  let constexpr Hasher() noexcept : state(offset) {}
 
-  method void reset() noexcept { sum = offset; }
+  method void reset() noexcept { state = offset; }
 
   method void write(mc c) noexcept {
-    var u64 hash = sum;
+    var u64 hash = state;
     for (uarch i = 0; i < c.len; i += 1) {
       hash ^= cast(u64, c.ptr[i]);
       hash *= prime;
     }
-    sum = hash;
+    state = hash;
   }
 
   method void write(u8 x) noexcept {
-    var u64 hash = sum;
+    var u64 hash = state;
     hash ^= cast(u64, x);
     hash *= prime;
-    sum = hash;
+    state = hash;
   }
 
+  method u64 sum() const noexcept { return state; }
 };
 
 fn u64 compute(mc c) noexcept {
     var Hasher h = Hasher();
     h.write(c);
-    return h.sum;
+    return h.sum();
 }
 
 } // namespace coven::hash::fnv64a
@@ -54,35 +56,26 @@ namespace coven::hash::map {
 
 // This implementation is a port from Go source code
 // Original can be found at hash/maphash/maphash_purego.go
+//
+// Words are read with native unaligned loads. On little endian platforms
+// they give the same values as byte by byte assembly in the original
 
-fn internal u32 le_u32(mc c) noexcept {
-  // must be c.len >= 4
-  return cast(u32, c.ptr[0]) | (cast(u32, c.ptr[1]) << 8) |
-         (cast(u32, c.ptr[2]) << 16) | (cast(u32, c.ptr[3]) << 24);
-}
-
-fn internal u64 r3(u64 k, mc c) noexcept {
-  return (cast(u64, c.ptr[0]) << 16) | (cast(u64, c.ptr[k >> 1]) << 8) |
-         cast(u64, c.ptr[k - 1]);
-}
+typedef u64 u64u __attribute__((may_alias, aligned(1)));
+typedef u32 u32u __attribute__((may_alias, aligned(1)));
 
-fn internal u64 r4(mc c) noexcept {
-  return cast(u64, le_u32(c));
+fn internal inline u64 r3(const u8* p, u64 k) noexcept {
+  return (cast(u64, p[0]) << 16) | (cast(u64, p[k >> 1]) << 8) | cast(u64, p[k - 1]);
 }
 
-fn internal u64 le_u64(mc c) noexcept {
-  // must be c.len >= 8
-  return cast(u64, c.ptr[0]) | (cast(u64, c.ptr[1]) << 8) |
-         (cast(u64, c.ptr[2]) << 16) | (cast(u64, c.ptr[3]) << 24) |
-         (cast(u64, c.ptr[4]) << 32) | (cast(u64, c.ptr[5]) << 40) |
-         (cast(u64, c.ptr[6]) << 48) | (cast(u64, c.ptr[7]) << 56);
+fn internal inline u64 r4(const u8* p) noexcept {
+  return cast(u64, *cast(const u32u*, p));
 }
 
-fn internal u64 r8(mc c) noexcept {
-  return le_u64(c);
+fn internal inline u64 r8(const u8* p) noexcept {
+  return *cast(const u64u*, p);
 }
 
-fn internal u64 mix(u64 a, u64 b) noexcept {
+fn internal inline u64 mix(u64 a, u64 b) noexcept {
   const u128 n = cast(u128, a) * cast(u128, b);
   const u64 lo = cast(u64, n);
   const u64 hi = cast(u64, (n >> 64));
@@ -96,63 +89,346 @@ internal const u64 m3 = 0x8ebc6af09c88c6e3;
 internal const u64 m4 = 0x589965cc75374cc3;
 internal const u64 m5 = 0x1d8e4e27c47d124f;
 
-fn internal u64 wyhash(u64 seed, mc c) noexcept {
-  const u64 len = c.len;
-
+// Number of bytes must be greater than zero
+fn internal inline u64 wyhash(u64 seed, const u8* p, uarch len) noexcept {
   seed ^= m1;
-  var u64 i = len;
+  var uarch i = len;
   if (i > 16) {
     if (i > 48) {
       var u64 seed1 = seed;
       var u64 seed2 = seed;
       for (; i > 48; i -= 48) {
-        seed = mix(r8(c) ^ m2, r8(c.slice_from(8)) ^ seed);
-        seed1 = mix(r8(c.slice_from(16)) ^ m3, r8(c.slice_from(24)) ^ seed1);
-        seed2 = mix(r8(c.slice_from(32)) ^ m4, r8(c.slice_from(40)) ^ seed2);
-        c = c.slice_from(48);
+        seed = mix(r8(p) ^ m2, r8(p + 8) ^ seed);
+        seed1 = mix(r8(p + 16) ^ m3, r8(p + 24) ^ seed1);
+        seed2 = mix(r8(p + 32) ^ m4, r8(p + 40) ^ seed2);
+        p += 48;
       }
       seed ^= seed1 ^ seed2;
     }
 
     for (; i > 16; i -= 16) {
-      seed = mix(r8(c) ^ m2, r8(c.slice_from(8)) ^ seed);
-      c = c.slice_from(16);
+      seed = mix(r8(p) ^ m2, r8(p + 8) ^ seed);
+      p += 16;
     }
   }
 
-  if (i == 0) {
-    return seed;
-  }
-
   var u64 a = 0;
   var u64 b = 0;
 
   if (i < 4) {
-    a = r3(i, c);
+    a = r3(p, i);
   } else {
-    const u64 n = (i >> 3) << 2;
-    a = (r4(c) << 32) | r4(c.slice_from(n));
-    b = (r4(c.slice_from(i - 4)) << 32) | r4(c.slice_from(i - 4 - n));
+    const uarch n = (i >> 3) << 2;
+    a = (r4(p) << 32) | r4(p + n);
+    b = (r4(p + i - 4) << 32) | r4(p + i - 4 - n);
   }
 
   return mix(m5 ^ len, mix(a ^ m2, b ^ seed));
 }
 
-fn internal u64 rthash(u64 seed, mc c) noexcept {
-  if (c.len == 0) {
+fn internal inline u64 rthash(u64 seed, const u8* p, uarch len) noexcept {
+  if (len == 0) {
     return seed;
   }
-  return wyhash(seed, c);
+  return wyhash(seed, p, len);
 }
 
-internal const u64 buf_size = 128;
+// Input is hashed in chunks of this size, result of each chunk is used
+// as seed for the next one. Hasher relies on this to give the same
+// result as compute no matter how input is split between writes
+internal const uarch buf_size = 128;
 
 fn u64 compute(u64 seed, mc c) noexcept {
-  while (c.len > buf_size) {
-    seed = rthash(seed, c.slice_to(buf_size));
-    c = c.slice_from(buf_size);
+  var const u8* p = c.ptr;
+  var uarch len = c.len;
+  while (len > buf_size) {
+    seed = wyhash(seed, p, buf_size);
+    p += buf_size;
+    len -= buf_size;
   }
-  return rthash(seed, c);
+  return rthash(seed, p, len);
 }
 
+// Streaming variant of compute. Sum of all written data is equal
+// to compute result for the same data and seed
+struct Hasher {
+  // Gathers input until a full chunk is ready
+  u8 buf[buf_size];
+
+  // Seed of the first chunk, restored by reset
+  u64 seed;
+
+  // Result of hashing all previous full chunks
+  u64 state;
+
+  // Number of bytes in buffer
+  uarch n;
+
+  let Hasher() noexcept : Hasher(0) {}
+
+  let Hasher(u64 s) noexcept : seed(s), state(s), n(0) {}
+
+  method void reset() noexcept {
+    state = seed;
+    n = 0;
+  }
+
+  method void write(mc c) noexcept {
+    var u8* p = c.ptr;
+    var uarch len = c.len;
+    while (len != 0) {
+      // full buffer is hashed only when more data arrives, since last
+      // chunk may be full as well
+      if (n == buf_size) {
+        state = wyhash(state, buf, buf_size);
+        n = 0;
+      }
+      if (n == 0) {
+        while (len > buf_size) {
+          state = wyhash(state, p, buf_size);
+          p += buf_size;
+          len -= buf_size;
+        }
+      }
+
+      const uarch k = min(buf_size - n, len);
+      mem::copy(p, buf + n, k);
+      n += k;
+      p += k;
+      len -= k;
+    }
+  }
+
+  method void write(u8 x) noexcept {
+    if (n == buf_size) {
+      state = wyhash(state, buf, buf_size);
+      n = 0;
+    }
+    buf[n] = x;
+    n += 1;
+  }
+
+  method u64 sum() const noexcept {
+    return rthash(state, buf, n);
+  }
+};
+
 }  // namespace coven::hash::map
+
+namespace coven::hash::word {
+
+// Hash for short strings, such as language keywords. Unlike other
+// hash functions here it can be evaluated at compile time, which
+// allows to build perfect hash tables for fixed sets of keys with
+// no setup at runtime
+//
+// Type C is u8 for runtime strings and char for string literals
+
+internal const u64 m1 = 0xa0761d6478bd642f;
+internal const u64 m2 = 0xe7037ed1a0b428db;
+internal const u64 m3 = 0x8ebc6af09c88c6e3;
+
+fn internal inline constexpr u64 mix(u64 a, u64 b) noexcept {
+  const u128 n = cast(u128, a) * cast(u128, b);
+  return cast(u64, n) ^ cast(u64, n >> 64);
+}
+
+// Assemble up to 8 bytes into little endian integer
+template <typename C>
+fn internal inline constexpr u64 load(const C* p, uarch n) noexcept {
+  if (!__builtin_is_constant_evaluated()) {
+    const uarch page_size = 1 << 12;
+
+    if (n == 8) {
+      return *cast(const map::u64u*, p);
+    }
+    // whole word is loaded when it does not cross a page, excess
+    // bytes are masked out
+    if (n != 0 && (cast(uptr, p) & (page_size - 1)) <= page_size - 8) {
+      return *cast(const map::u64u*, p) & (~cast(u64, 0) >> ((8 - n) << 3));
+    }
+  }
+
+  var u64 x = 0;
+  for (uarch i = 0; i < n; i += 1) {
+    x |= cast(u64, cast(u8, p[i])) << (i << 3);
+  }
+  return x;
+}
+
+// Type C is u8 for strings at runtime and char for string literals
+template <typename C>
+fn internal inline constexpr u64 compute(u64 seed, const C* p, uarch n) noexcept {
+  var u64 h = seed ^ m1;
+  var uarch i = 0;
+  for (; i + 8 <= n; i += 8) {
+    h = mix(load(p + i, 8) ^ m2, h ^ m3);
+  }
+  return mix(load(p + i, n - i) ^ m2, h ^ n);
+}
+
+}  // namespace coven::hash::word
+
+namespace coven::hash::native {
+
+// Fastest hash available on the processor program runs on. Uses AES
+// rounds when supported and falls back to hash::map otherwise. Results
+// differ between machines, thus they must not be stored or sent anywhere.
+// Use hash::map for tables which are built ahead of time
+//
+// AES variant follows structure of aeshashbody from Go source code,
+// which can be found at runtime/asm_amd64.s. Inputs shorter than 16 bytes
+// are read with overlapping scalar loads instead of masked vector load
+
+typedef u8 u8x16 __attribute__((vector_size(16)));
+typedef u8 u8x16u __attribute__((vector_size(16), may_alias, aligned(1)));
+typedef u64 u64x2 __attribute__((vector_size(16)));
+
+// AES builtins operate on vectors of long long
+typedef long long i64x2 __attribute__((vector_size(16)));
+
+// Number of 16-byte lanes used for long inputs
+internal const uarch lanes = 8;
+
+// Replaces per-process random key schedule of the original. Seed
+// argument is used to make hashes of different tables unrelated
+struct Schedule {
+  alignas(16) u64 words[lanes * 2];
+};
+
+fn internal constexpr Schedule make_schedule() noexcept {
+  var Schedule s = {};
+  var u64 x = word::m1;
+  for (uarch i = 0; i < lanes * 2; i += 1) {
+    x += word::m2;
+    s.words[i] = word::mix(x, x ^ word::m3);
+  }
+  return s;
+}
+
+internal constexpr Schedule schedule = make_schedule();
+
+fn internal inline __attribute__((target("aes"))) u8x16 aesenc(u8x16 x, u8x16 key) noexcept {
+  return cast(u8x16, __builtin_ia32_aesenc128(cast(i64x2, x), cast(i64x2, key)));
+}
+
+fn internal inline u8x16 load(const u8* p) noexcept {
+  return *cast(const u8x16u*, p);
+}
+
+// Loads n bytes, which must be less than 16, without reading past the end
+// of input. Loads may overlap, resulting vector is unique for given length
+fn internal inline u8x16 load_short(const u8* p, uarch n) noexcept {
+  var u64x2 v = {};
+  if (n >= 8) {
+    v[0] = map::r8(p);
+    v[1] = map::r8(p + n - 8);
+  } else if (n >= 4) {
+    v[0] = (map::r4(p) << 32) | map::r4(p + n - 4);
+  } else if (n != 0) {
+    v[0] = map::r3(p, n);
+  }
+  return cast(u8x16, v);
+}
+
+fn internal inline u8x16 key(uarch i) noexcept {
+  return *cast(const u8x16*, schedule.words + 2 * i);
+}
+
+fn internal inline u64 low(u8x16 x) noexcept {
+  const u64x2 v = cast(u64x2, x);
+  return v[0];
+}
+
+// Scrambles state and mixes block of input into it
+fn internal inline __attribute__((target("aes"))) u8x16 round(u8x16 state, u8x16 x) noexcept {
+  return aesenc(aesenc(state, state), x);
+}
+
+// Scrambles x three times and combines it into accumulator
+fn internal inline __attribute__((target("aes"))) u8x16 finish(u8x16 acc, u8x16 x) noexcept {
+  x = aesenc(x, x);
+  x = aesenc(x, x);
+  x = aesenc(x, x);
+  return acc ^ x;
+}
+
+fn internal __attribute__((target("aes"))) u64 compute_aes(u64 seed, const u8* p, uarch n) noexcept {
+  // seed and 16 lower bits of length repeated four times
+  const u64 l = cast(u64, cast(u16, n)) * 0x0001000100010001;
+  const u64x2 sl = {seed, l};
+  const u8x16 s = cast(u8x16, sl);
+
+  var u8x16 seeds[lanes] dirty;
+  seeds[0] = s ^ key(0);
+  seeds[0] = aesenc(seeds[0], seeds[0]);
+
+  if (n <= 16) {
+    var u8x16 x dirty;
+    if (n == 16) {
+      x = load(p);
+    } else {
+      x = load_short(p, n);
+    }
+    const u8x16 h = finish(u8x16{}, x ^ seeds[0]);
+    return low(h);
+  }
+
+  var uarch k = 2;
+  if (n > 32) {
+    k = 4;
+  }
+  if (n > 64) {
+    k = lanes;
+  }
+  for (uarch i = 1; i < k; i += 1) {
+    seeds[i] = s ^ key(i);
+    seeds[i] = aesenc(seeds[i], seeds[i]);
+  }
+
+  if (n <= 128) {
+    // first and last halves of input overlap when n is not a power of two
+    var u8x16 h = {};
+    const uarch half = k >> 1;
+    for (uarch i = 0; i < half; i += 1) {
+      h = finish(h, load(p + 16 * i) ^ seeds[i]);
+      h = finish(h, load(p + n - 16 * (half - i)) ^ seeds[half + i]);
+    }
+    return low(h);
+  }
+
+  // state starts from last (possibly overlapping) block
+  var u8x16 state[lanes] dirty;
+  for (uarch i = 0; i < lanes; i += 1) {
+    state[i] = load(p + n - 16 * (lanes - i)) ^ seeds[i];
+  }
+
+  // lanes are spelled out to keep state in registers
+  var uarch blocks = (n - 1) >> 7;
+  for (; blocks != 0; blocks -= 1) {
+    state[0] = round(state[0], load(p));
+    state[1] = round(state[1], load(p + 16));
+    state[2] = round(state[2], load(p + 32));
+    state[3] = round(state[3], load(p + 48));
+    state[4] = round(state[4], load(p + 64));
+    state[5] = round(state[5], load(p + 80));
+    state[6] = round(state[6], load(p + 96));
+    state[7] = round(state[7], load(p + 112));
+    p += 16 * lanes;
+  }
+
+  var u8x16 h = {};
+  for (uarch i = 0; i < lanes; i += 1) {
+    h = finish(h, state[i]);
+  }
+  return low(h);
+}
+
+fn inline u64 compute(u64 seed, mc c) noexcept {
+  if (cpu::features().aes) {
+    return compute_aes(seed, c.ptr, c.len);
+  }
+  return map::compute(seed, c);
+}
+
+}  // namespace coven::hash::native
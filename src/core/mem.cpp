@@ -18,6 +18,9 @@ struct AllocResult {
 
   let AllocResult(mc m) noexcept : m(m), code(Code::Ok) {}
   let AllocResult(Code code) noexcept : m(mc()), code(code) {}
+
+  method bool is_ok() const noexcept { return code == Code::Ok; }
+  method bool is_err() const noexcept { return code != Code::Ok; }
 };
 
 // Allocates (maps) at least n bytes of virtual memory in whole pages
@@ -32,6 +35,43 @@ struct AllocResult {
 // a requested amount of memory
 fn AllocResult alloc(uarch n) noexcept;
 
+// Size of transparent huge page
+const uarch huge_page_size = 1 << 21;
+
+// Options of memory mapping requested from OS
+struct AllocOptions {
+  // Back memory with transparent huge pages if OS allows it. Mapping
+  // is aligned by huge page size and its length is rounded up to
+  // a multiple of huge page size
+  bool huge_pages;
+
+  // Prefault all pages of the mapping upfront, so that first access
+  // to memory does not trigger page faults
+  bool populate;
+
+  // Do not reserve swap space for the mapping. Memory which was not
+  // touched yet does not count towards OS commit limit
+  bool noreserve;
+};
+
+// Same as alloc, but mapping is made with given options
+fn AllocResult alloc(uarch n, AllocOptions opts) noexcept;
+
+// Reserves at least n bytes of virtual address space without making
+// it accessible. Reserved memory does not consume physical pages or
+// swap until it is committed. Reserved range is released with free
+// function as a whole
+fn AllocResult reserve(uarch n, AllocOptions opts) noexcept;
+
+// Makes part of previously reserved range accessible for reading and
+// writing. Chunk must start and end at page boundaries
+fn AllocResult commit(mc c, AllocOptions opts) noexcept;
+
+// Grows memory chunk that was received from alloc function to at
+// least n bytes. Contents of the chunk are preserved, but it may be
+// moved to another address. Pages are remapped, no bytes are copied
+fn AllocResult realloc(mc c, uarch n) noexcept;
+
 struct FreeResult {
   enum struct Code : u8 {
     Ok = 0,
@@ -41,6 +81,12 @@ struct FreeResult {
   };
 
   Code code;
+
+  let FreeResult() noexcept : code(Code::Ok) {}
+  let FreeResult(Code code) noexcept : code(code) {}
+
+  method bool is_ok() const noexcept { return code == Code::Ok; }
+  method bool is_err() const noexcept { return code != Code::Ok; }
 };
 
 // Free (unmap) memory chunk that was received from alloc
@@ -51,15 +97,303 @@ fn FreeResult free(mc c) noexcept;
 
 namespace coven::mem {
 
+typedef u8 u8x16 __attribute__((vector_size(16), may_alias, aligned(1)));
+typedef u8 u8x32 __attribute__((vector_size(32), may_alias, aligned(1)));
+typedef u64 u64u __attribute__((may_alias, aligned(1)));
+typedef u32 u32u __attribute__((may_alias, aligned(1)));
+typedef u16 u16u __attribute__((may_alias, aligned(1)));
+
+// Vector types are wrapped into structs, because template arguments
+// lose attributes (unaligned access) of typedefs
+struct Xmm {
+  typedef u8x16 Vec;
+};
+
+struct Ymm {
+  typedef u8x32 Vec;
+};
+
+// Copies n < 32 bytes. All bytes are loaded before anything is stored,
+// thus regions may overlap in any way
+fn internal inline void copy_small(const u8* src, u8* dst, uarch n) noexcept {
+  if (n >= 16) {
+    const u8x16 a = *cast(const u8x16*, src);
+    const u8x16 b = *cast(const u8x16*, src + n - 16);
+    *cast(u8x16*, dst) = a;
+    *cast(u8x16*, dst + n - 16) = b;
+    return;
+  }
+  if (n >= 8) {
+    const u64 a = *cast(const u64u*, src);
+    const u64 b = *cast(const u64u*, src + n - 8);
+    *cast(u64u*, dst) = a;
+    *cast(u64u*, dst + n - 8) = b;
+    return;
+  }
+  if (n >= 4) {
+    const u32 a = *cast(const u32u*, src);
+    const u32 b = *cast(const u32u*, src + n - 4);
+    *cast(u32u*, dst) = a;
+    *cast(u32u*, dst + n - 4) = b;
+    return;
+  }
+  if (n >= 2) {
+    const u16 a = *cast(const u16u*, src);
+    const u16 b = *cast(const u16u*, src + n - 2);
+    *cast(u16u*, dst) = a;
+    *cast(u16u*, dst + n - 2) = b;
+    return;
+  }
+  dst[0] = src[0];
+}
+
+// Copies n bytes, where K * w <= n <= 2 * K * w for vector width w, with
+// K vectors taken from start and K vectors from end of src. All vectors
+// are loaded before anything is stored, thus regions may overlap in any way
+template <typename R, uarch K>
+fn internal inline void copy_ends(const u8* src, u8* dst, uarch n) noexcept {
+  typedef typename R::Vec V;
+  const uarch w = sizeof(V);
+
+  var V head[K] dirty;
+  var V tail[K] dirty;
+  for (uarch i = 0; i < K; i += 1) {
+    head[i] = *cast(const V*, src + i * w);
+    tail[i] = *cast(const V*, src + n - (K - i) * w);
+  }
+  for (uarch i = 0; i < K; i += 1) {
+    *cast(V*, dst + i * w) = head[i];
+    *cast(V*, dst + n - (K - i) * w) = tail[i];
+  }
+}
+
+// Copies 32 <= n <= inline_copy_limit bytes without loops, regions
+// may overlap in any way
+fn internal inline void copy_medium(const u8* src, u8* dst, uarch n) noexcept {
+  if (n <= 64) {
+    copy_ends<Xmm, 2>(src, dst, n);
+    return;
+  }
+  if (n <= 128) {
+    copy_ends<Xmm, 4>(src, dst, n);
+    return;
+  }
+  copy_ends<Xmm, 8>(src, dst, n);
+}
+
+// Fills n < 16 bytes with value x
+fn internal inline void fill_small(u8* dst, u8 x, uarch n) noexcept {
+  if (n >= 8) {
+    const u64 v = cast(u64, x) * 0x0101010101010101;
+    *cast(u64u*, dst) = v;
+    *cast(u64u*, dst + n - 8) = v;
+    return;
+  }
+  if (n >= 4) {
+    const u32 v = cast(u32, x) * 0x01010101;
+    *cast(u32u*, dst) = v;
+    *cast(u32u*, dst + n - 4) = v;
+    return;
+  }
+  for (uarch i = 0; i < n; i += 1) {
+    dst[i] = x;
+  }
+}
+
+// Copies n >= sizeof(R::Vec) bytes in vector blocks going from start
+// to end. Stores inside the loop are aligned. First and last blocks are
+// loaded before the loop and stored after it, thus dst may overlap src
+// as long as it is placed before src
+template <typename R>
+fn internal inline void copy_forward(const u8* src, u8* dst, uarch n) noexcept {
+  typedef typename R::Vec V;
+  const uarch w = sizeof(V);
+  const V head = *cast(const V*, src);
+  const V tail = *cast(const V*, src + n - w);
+
+  var uarch i = w - (cast(uptr, dst) & (w - 1));
+  for (; i + 4 * w <= n; i += 4 * w) {
+    const V a = *cast(const V*, src + i);
+    const V b = *cast(const V*, src + i + w);
+    const V c = *cast(const V*, src + i + 2 * w);
+    const V d = *cast(const V*, src + i + 3 * w);
+    *cast(V*, dst + i) = a;
+    *cast(V*, dst + i + w) = b;
+    *cast(V*, dst + i + 2 * w) = c;
+    *cast(V*, dst + i + 3 * w) = d;
+  }
+  for (; i + w <= n; i += w) {
+    *cast(V*, dst + i) = *cast(const V*, src + i);
+  }
+
+  *cast(V*, dst) = head;
+  *cast(V*, dst + n - w) = tail;
+}
+
+// Same as copy_forward, but goes from end to start. Regions may
+// overlap as long as dst is placed after src
+template <typename R>
+fn internal inline void copy_backward(const u8* src, u8* dst, uarch n) noexcept {
+  typedef typename R::Vec V;
+  const uarch w = sizeof(V);
+  const V head = *cast(const V*, src);
+  const V tail = *cast(const V*, src + n - w);
+
+  var uarch i = n - ((cast(uptr, dst) + n) & (w - 1));
+  while (i >= 4 * w) {
+    i -= 4 * w;
+    const V a = *cast(const V*, src + i + 3 * w);
+    const V b = *cast(const V*, src + i + 2 * w);
+    const V c = *cast(const V*, src + i + w);
+    const V d = *cast(const V*, src + i);
+    *cast(V*, dst + i + 3 * w) = a;
+    *cast(V*, dst + i + 2 * w) = b;
+    *cast(V*, dst + i + w) = c;
+    *cast(V*, dst + i) = d;
+  }
+  while (i > w) {
+    i -= w;
+    *cast(V*, dst + i) = *cast(const V*, src + i);
+  }
+
+  *cast(V*, dst + n - w) = tail;
+  *cast(V*, dst) = head;
+}
+
+// Fills n >= sizeof(R::Vec) bytes with value x in vector blocks
+template <typename R>
+fn internal inline void fill_blocks(u8* dst, u8 x, uarch n) noexcept {
+  typedef typename R::Vec V;
+  const uarch w = sizeof(V);
+  const V v = V{} + x;
+
+  *cast(V*, dst) = v;
+  var uarch i = w - (cast(uptr, dst) & (w - 1));
+  for (; i + 4 * w <= n; i += 4 * w) {
+    *cast(V*, dst + i) = v;
+    *cast(V*, dst + i + w) = v;
+    *cast(V*, dst + i + 2 * w) = v;
+    *cast(V*, dst + i + 3 * w) = v;
+  }
+  for (; i + w <= n; i += w) {
+    *cast(V*, dst + i) = v;
+  }
+  *cast(V*, dst + n - w) = v;
+}
+
+fn internal inline void rep_movsb(const u8* src, u8* dst, uarch n) noexcept {
+  asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+fn internal inline void rep_stosb(u8* dst, u8 x, uarch n) noexcept {
+  asm volatile("rep stosb" : "+D"(dst), "+c"(n) : "a"(x) : "memory");
+}
+
+// Copies up to this size are done inline with 16 byte vectors without
+// loops, bigger ones go through kernels selected for the processor
+internal const uarch inline_copy_limit = 256;
+
+// Copies smaller than this are done in vector registers. On processors
+// with enhanced rep movsb (ERMS) bigger copies are done by microcoded
+// string instructions which move whole cache lines at once
+internal const uarch rep_movsb_threshold = 4096;
+
+// Implementations of copy and fill operations for blocks of at least
+// 32 bytes. Variant for each operation is selected once according to
+// features of processor program runs on
+struct MemKernels {
+  // Regions must not overlap or dst must be placed before src
+  void (*copy_forward)(const u8* src, u8* dst, uarch n);
+
+  // Regions may overlap, dst must be placed after src
+  void (*copy_backward)(const u8* src, u8* dst, uarch n);
+
+  void (*fill)(u8* dst, u8 x, uarch n);
+};
+
+fn internal void copy_forward_sse2(const u8* src, u8* dst, uarch n) noexcept {
+  copy_forward<Xmm>(src, dst, n);
+}
+
+fn internal void copy_backward_sse2(const u8* src, u8* dst, uarch n) noexcept {
+  copy_backward<Xmm>(src, dst, n);
+}
+
+fn internal void fill_sse2(u8* dst, u8 x, uarch n) noexcept {
+  fill_blocks<Xmm>(dst, x, n);
+}
+
+// Generic block loops are compiled for baseline target, flatten makes
+// compiler inline them into the kernel with AVX2 enabled
+fn internal __attribute__((target("avx2"), flatten)) void copy_forward_avx2(const u8* src, u8* dst, uarch n) noexcept {
+  copy_forward<Ymm>(src, dst, n);
+}
+
+fn internal __attribute__((target("avx2"), flatten)) void copy_backward_avx2(const u8* src, u8* dst, uarch n) noexcept {
+  copy_backward<Ymm>(src, dst, n);
+}
+
+fn internal __attribute__((target("avx2"), flatten)) void fill_avx2(u8* dst, u8 x, uarch n) noexcept {
+  fill_blocks<Ymm>(dst, x, n);
+}
+
+fn internal __attribute__((target("avx2"), flatten)) void copy_forward_erms(const u8* src, u8* dst, uarch n) noexcept {
+  if (n < rep_movsb_threshold) {
+    copy_forward_avx2(src, dst, n);
+    return;
+  }
+  rep_movsb(src, dst, n);
+}
+
+fn internal __attribute__((target("avx2"), flatten)) void fill_erms(u8* dst, u8 x, uarch n) noexcept {
+  if (n < rep_movsb_threshold) {
+    fill_blocks<Ymm>(dst, x, n);
+    return;
+  }
+  rep_stosb(dst, x, n);
+}
+
+fn internal MemKernels select_mem_kernels() noexcept {
+  const cpu::Features& f = cpu::features();
+
+  if (f.avx2 && f.erms) {
+    return MemKernels{
+        .copy_forward = copy_forward_erms,
+        .copy_backward = copy_backward_avx2,
+        .fill = fill_erms,
+    };
+  }
+  if (f.avx2) {
+    return MemKernels{
+        .copy_forward = copy_forward_avx2,
+        .copy_backward = copy_backward_avx2,
+        .fill = fill_avx2,
+    };
+  }
+  return MemKernels{
+      .copy_forward = copy_forward_sse2,
+      .copy_backward = copy_backward_sse2,
+      .fill = fill_sse2,
+  };
+}
+
+var internal const MemKernels mem_kernels = select_mem_kernels();
+
 fn void copy(u8* restrict src, u8* restrict dst, uarch n) noexcept {
   must(n != 0);
   must(src != 0);
   must(dst != 0);
   must(src != dst);
 
-  for (uarch i = 0; i < n; i += 1) {
-    dst[i] = src[i];
+  if (n < 32) {
+    copy_small(src, dst, n);
+    return;
   }
+  if (n <= inline_copy_limit) {
+    copy_medium(src, dst, n);
+    return;
+  }
+  mem_kernels.copy_forward(src, dst, n);
 }
 
 fn void move(u8* restrict src, u8* dst, uarch n) noexcept {
@@ -68,26 +402,171 @@ fn void move(u8* restrict src, u8* dst, uarch n) noexcept {
   must(dst != 0);
   must(src != dst);
 
+  if (n < 32) {
+    copy_small(src, dst, n);
+    return;
+  }
+  if (n <= inline_copy_limit) {
+    copy_medium(src, dst, n);
+    return;
+  }
+
   const uptr a = cast(uptr, src);
   const uptr b = cast(uptr, dst);
 
-  if (a > b) {
-    must(a - b < n); // if violated than regular copy should be used
+  if (b + n <= a || a + n <= b) {
+    // regions do not overlap
+    mem_kernels.copy_forward(src, dst, n);
+    return;
+  }
+  if (b < a) {
+    // string instructions are not used for overlapping regions
+    copy_forward<Xmm>(src, dst, n);
+    return;
+  }
+  mem_kernels.copy_backward(src, dst, n);
+}
 
-    for (uarch i = 0; i < n; i += 1) {
-      dst[i] = src[i];
-    }
+fn void fill(u8* dst, u8 x, uarch n) noexcept {
+  must(n != 0);
+  must(dst != 0);
+
+  if (n < 16) {
+    fill_small(dst, x, n);
+    return;
+  }
+  if (n <= inline_copy_limit) {
+    fill_blocks<Xmm>(dst, x, n);
     return;
   }
+  mem_kernels.fill(dst, x, n);
+}
+
+// Byte scanning functions below process input in blocks. Each block
+// is compared against the byte being searched for in one go and comparison
+// outcome is packed into a bit mask (bit i is set when byte i of the
+// block matches). Block width depends on kernel variant selected at
+// startup: 32 bytes with AVX2, 16 bytes with SSE2 (always available on amd64)
+typedef char c8x16 __attribute__((vector_size(16)));
+typedef char c8x32 __attribute__((vector_size(32)));
+
+fn internal inline u32 match_mask_sse2(const u8* p, u8 x) noexcept {
+  const u8x16 v = *cast(const u8x16*, p);
+  const u8x16 m = cast(u8x16, v == (u8x16{} + x));
+  return cast(u32, __builtin_ia32_pmovmskb128(cast(c8x16, m)));
+}
+
+fn internal inline __attribute__((target("avx2"))) u32 match_mask_avx2(const u8* p, u8 x) noexcept {
+  const u8x32 v = *cast(const u8x32*, p);
+  const u8x32 m = cast(u8x32, v == (u8x32{} + x));
+  return cast(u32, __builtin_ia32_pmovmskb256(cast(c8x32, m)));
+}
+
+struct ScanResult {
+  // Number of positions written to output
+  uarch n;
+
+  // Offset inside scanned chunk from which scanning must be resumed
+  // to find remaining occurrences. Equals chunk length when scan is
+  // complete
+  uarch pos;
+};
+
+template <uarch W, u32 (*match)(const u8*, u8)>
+fn internal inline uarch count_byte_blocks(mc c, u8 x) noexcept {
+  var uarch n = 0;
+  var uarch i = 0;
+  for (; i + W <= c.len; i += W) {
+    n += bits::pop_count(match(c.ptr + i, x));
+  }
+  for (; i < c.len; i += 1) {
+    if (c.ptr[i] == x) {
+      n += 1;
+    }
+  }
+  return n;
+}
+
+template <uarch W, u32 (*match)(const u8*, u8)>
+fn internal inline ScanResult index_byte_blocks(mc c, u8 x, chunk<uarch> out) noexcept {
+  var uarch n = 0;
+  var uarch i = 0;
+  for (; i + W <= c.len; i += W) {
+    var u32 mask = match(c.ptr + i, x);
+    while (mask != 0) {
+      const uarch k = i + bits::trailing_zeros(mask);
+      if (n == out.len) {
+        return ScanResult{.n = n, .pos = k};
+      }
+
+      out.ptr[n] = k;
+      n += 1;
+      mask &= mask - 1;
+    }
+  }
+
+  for (; i < c.len; i += 1) {
+    if (c.ptr[i] == x) {
+      if (n == out.len) {
+        return ScanResult{.n = n, .pos = i};
+      }
+
+      out.ptr[n] = i;
+      n += 1;
+    }
+  }
+
+  return ScanResult{.n = n, .pos = c.len};
+}
+
+fn internal uarch count_byte_sse2(mc c, u8 x) noexcept {
+  return count_byte_blocks<16, match_mask_sse2>(c, x);
+}
+
+// Generic block loop is compiled for baseline target, flatten makes
+// compiler inline it together with AVX2 match mask into the kernel
+fn internal __attribute__((target("avx2"), flatten)) uarch count_byte_avx2(mc c, u8 x) noexcept {
+  return count_byte_blocks<32, match_mask_avx2>(c, x);
+}
+
+fn internal ScanResult index_byte_sse2(mc c, u8 x, chunk<uarch> out) noexcept {
+  return index_byte_blocks<16, match_mask_sse2>(c, x, out);
+}
+
+fn internal __attribute__((target("avx2"), flatten)) ScanResult index_byte_avx2(mc c, u8 x, chunk<uarch> out) noexcept {
+  return index_byte_blocks<32, match_mask_avx2>(c, x, out);
+}
+
+typedef uarch (*CountByteKernel)(mc c, u8 x);
+typedef ScanResult (*IndexByteKernel)(mc c, u8 x, chunk<uarch> out);
+
+var internal const CountByteKernel count_byte_kernel = cpu::Table<CountByteKernel>{{
+    count_byte_sse2,
+    nil,
+    count_byte_avx2,
+    nil,
+}}.select();
 
-  must(b - a < n); // if violated than regular copy should be used
+var internal const IndexByteKernel index_byte_kernel = cpu::Table<IndexByteKernel>{{
+    index_byte_sse2,
+    nil,
+    index_byte_avx2,
+    nil,
+}}.select();
 
-  // copy starting from the end
-  var uarch i = n;
-  do {
-    i -= 1;
-    dst[i] = src[i];
-  } while (i != 0);
+// Returns number of occurrences of byte x inside memory chunk
+fn uarch count_byte(mc c, u8 x) noexcept {
+  return count_byte_kernel(c, x);
+}
+
+// Find all occurrences of byte x inside memory chunk and write their
+// offsets (relative to chunk start) into output in increasing order
+//
+// Scanning stops early when output has no more room. Returned result
+// describes how many offsets were written and where scanning must be
+// resumed from
+fn ScanResult index_byte(mc c, u8 x, chunk<uarch> out) noexcept {
+  return index_byte_kernel(c, x, out);
 }
 
 struct Arena {
@@ -99,9 +578,26 @@ struct Arena {
   // inside arena
   uarch pos;
 
-  let Arena(mc buf) noexcept : buf(buf), pos(0) {
+  // Start position of the most recent allocation. Equals pos
+  // if there is no allocation which can be grown in place
+  uarch last;
+
+  // Number of bytes at the start of buffer which are accessible.
+  // Buffer beyond this point is reserved, but not committed yet
+  uarch committed;
+
+  // Options for committing reserved part of the buffer
+  os::AllocOptions opts;
+
+  let Arena(mc buf) noexcept : Arena(buf, buf.len, os::AllocOptions{}) {}
+
+  // Create arena over buffer of which only first committed bytes
+  // are accessible, the rest is committed as arena grows
+  let Arena(mc buf, uarch committed, os::AllocOptions opts) noexcept
+      : buf(buf), pos(0), last(0), committed(committed), opts(opts) {
     must(!buf.is_nil());
     must(bits::is_aligned_by_16(buf.ptr));
+    must(committed <= buf.len);
   }
 
   // Allocate at least n bytes of memory
@@ -113,11 +609,14 @@ struct Arena {
 
     n = bits::align_by_16(n);
     must(n <= rem());
+    if (pos + n > committed) {
+      commit(pos + n);
+    }
 
-    const uarch prev = pos;
+    last = pos;
     pos += n;
 
-    return buf.slice(prev, pos);
+    return buf.slice(last, pos);
   }
 
   template <typename T>
@@ -144,14 +643,50 @@ struct Arena {
     return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
   }
 
+  // Grow memory chunk to at least n bytes. The most recent allocation
+  // is grown in place, other chunks are copied
   method mc realloc(mc c, uarch n) noexcept {
     must(n > c.len);
 
+    if (last < pos && c.ptr == buf.ptr + last) {
+      const uarch end = last + bits::align_by_16(n);
+      if (end <= buf.len) {
+        if (end > committed) {
+          commit(end);
+        }
+        pos = end;
+        return buf.slice(last, pos);
+      }
+    }
+
     var mc c2 = alloc(n);
     c2.unsafe_write(c);
     return c2;
   }
 
+  // Memory of the most recent allocation is made available for
+  // next allocations, freeing any other chunk has no effect
+  method void free(mc c) noexcept {
+    if (last < pos && c.ptr == buf.ptr + last) {
+      pos = last;
+    }
+  }
+
+  // Make first end bytes of buffer accessible. Memory is committed
+  // in steps of huge page size to keep number of system calls low
+  method void commit(uarch end) noexcept {
+    must(end <= buf.len);
+
+    var uarch limit = bits::align_by_2mb(end);
+    if (limit > buf.len) {
+      limit = buf.len;
+    }
+
+    const os::AllocResult r = os::commit(buf.slice(committed, limit), opts);
+    must(r.is_ok());
+    committed = limit;
+  }
+
   template <typename T>
   method chunk<T> realloc(chunk<T> c, uarch n) noexcept {
     static_assert(sizeof(T) != 0);
@@ -188,52 +723,734 @@ struct Arena {
     must(n <= pos);
 
     pos -= n;
+    last = pos;
   }
 
   // Drops all allocated memory and makes entire buffer
   // available for future allocations
-  method void reset() noexcept { pos = 0; }
+  method void reset() noexcept {
+    pos = 0;
+    last = 0;
+  }
+
+  // Saved arena position, see save and restore methods
+  struct Checkpoint {
+    uarch pos;
+  };
+
+  method Checkpoint save() const noexcept { return Checkpoint{.pos = pos}; }
+
+  // Drops all allocations made after checkpoint was saved
+  method void restore(Checkpoint cp) noexcept {
+    must(cp.pos <= pos);
+
+    pos = cp.pos;
+    last = pos;
+  }
+};
+
+// Create arena over reserved range of at least n bytes of virtual
+// memory. Physical memory is committed only as arena grows, thus
+// reserving far more than will be used is cheap
+fn Arena reserve_arena(uarch n, os::AllocOptions opts) noexcept {
+  const os::AllocResult r = os::reserve(n, opts);
+  must(r.is_ok());
+  return Arena(r.m, 0, opts);
+}
+
+// Smallest block requested by chained arena from OS
+internal const uarch chain_arena_min_block_size = 1 << 16;
+
+// Block size of chained arena stops doubling at this limit
+internal const uarch chain_arena_max_block_size = 1 << 26;
+
+// Arena which is not limited by a fixed buffer
+//
+// Memory is allocated from blocks requested from OS. When current
+// block is full a new one (twice as big as previous) is chained to it,
+// thus memory usage follows actual demand instead of an upfront
+// estimate. Allocations made after a checkpoint can be dropped all
+// at once, blocks which are no longer used are returned to OS
+struct ChainArena {
+  // Header placed at the start of each block
+  struct Block {
+    // Previously allocated block, nil for the first one
+    Block* prev;
+
+    // Length of the whole block including header
+    uarch size;
+  };
+
+  // Saved arena position, see save and restore methods
+  struct Checkpoint {
+    // Block which was current at the moment of saving
+    Block* block;
+
+    uarch pos;
+  };
+
+  // Block from which allocations are currently made
+  Block* block;
+
+  // Most recently dropped block, kept to avoid mapping a new block
+  // when scope repeatedly crosses block boundary
+  Block* spare;
+
+  // Usable memory of current block
+  mc buf;
+
+  // Position of next chunk to be allocated inside current block
+  uarch pos;
+
+  // Start position of the most recent allocation inside current block
+  uarch last;
+
+  // Size of next block requested from OS
+  uarch block_size;
+
+  let ChainArena() noexcept : ChainArena(chain_arena_min_block_size) {}
+
+  // Argument n is a size hint for the first block
+  let ChainArena(uarch n) noexcept
+      : block(nil),
+        spare(nil),
+        buf(),
+        pos(0),
+        last(0),
+        block_size(bits::align_by_4kb(n < chain_arena_min_block_size ? chain_arena_min_block_size : n)) {}
+
+  // Allocate at least n bytes of memory
+  //
+  // Returns allocated memory chunk. Note that its length
+  // may be bigger than number of bytes requested
+  method mc alloc(uarch n) noexcept {
+    must(n != 0);
+
+    n = bits::align_by_16(n);
+    if (n > buf.len - pos) {
+      grow(n);
+    }
+
+    last = pos;
+    pos += n;
+
+    return buf.slice(last, pos);
+  }
+
+  template <typename T>
+  method chunk<T> alloc(uarch n) noexcept {
+    static_assert(sizeof(T) != 0);
+
+    const mc c = alloc(chunk_size(T, n));
+
+    return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
+  }
+
+  method mc calloc(uarch n) noexcept {
+    var mc c = alloc(n);
+    c.clear();
+    return c;
+  }
+
+  template <typename T>
+  method chunk<T> calloc(uarch n) noexcept {
+    static_assert(sizeof(T) != 0);
+
+    const mc c = calloc(chunk_size(T, n));
+
+    return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
+  }
+
+  // Grow memory chunk to at least n bytes. The most recent allocation
+  // is grown in place while it fits into current block, other chunks
+  // are copied
+  method mc realloc(mc c, uarch n) noexcept {
+    must(n > c.len);
+
+    if (last < pos && c.ptr == buf.ptr + last) {
+      const uarch end = last + bits::align_by_16(n);
+      if (end <= buf.len) {
+        pos = end;
+        return buf.slice(last, pos);
+      }
+    }
+
+    var mc c2 = alloc(n);
+    c2.unsafe_write(c);
+    return c2;
+  }
+
+  template <typename T>
+  method chunk<T> realloc(chunk<T> c, uarch n) noexcept {
+    static_assert(sizeof(T) != 0);
+
+    const mc c2 = realloc(c.as_mc(), chunk_size(T, n));
+
+    return chunk<T>(cast(T*, c2.ptr), c2.len / sizeof(T));
+  }
+
+  // Memory of the most recent allocation is made available for
+  // next allocations, freeing any other chunk has no effect
+  method void free(mc c) noexcept {
+    if (last < pos && c.ptr == buf.ptr + last) {
+      pos = last;
+    }
+  }
+
+  // Allocate a non-overlapping copy of given memory chunk.
+  // In contrast with alloc method returned chunk will be
+  // of exactly the same length as original one
+  method mc allocate_copy(mc c) noexcept {
+    var mc cp = alloc(c.len);
+    cp.unsafe_write(c);
+    return cp.slice_to(c.len);
+  }
+
+  method Checkpoint save() const noexcept { return Checkpoint{.block = block, .pos = pos}; }
+
+  // Drops all allocations made after checkpoint was saved. Blocks
+  // chained after checkpoint are released
+  method void restore(Checkpoint cp) noexcept {
+    while (block != cp.block) {
+      must(block != nil);
+      drop();
+    }
+
+    must(cp.pos <= pos);
+    pos = cp.pos;
+    last = pos;
+  }
+
+  // Drops all allocated memory. At most one block is kept for
+  // future allocations
+  method void reset() noexcept { restore(Checkpoint{.block = nil, .pos = 0}); }
+
+  // Drops all allocated memory and returns all blocks to OS
+  method void release() noexcept {
+    reset();
+    if (spare != nil) {
+      unmap(spare);
+      spare = nil;
+    }
+  }
+
+  // Chain a new block which fits at least n bytes
+  method void grow(uarch n) noexcept {
+    const uarch size = n + sizeof(Block);
+
+    var Block* b = nil;
+    if (spare != nil && spare->size >= size) {
+      b = spare;
+      spare = nil;
+    } else {
+      // big blocks are backed by huge pages to reduce TLB misses
+      const uarch len = size > block_size ? size : block_size;
+      const os::AllocOptions opts = {
+          .huge_pages = len >= os::huge_page_size,
+          .populate = false,
+          .noreserve = false,
+      };
+      const os::AllocResult r = os::alloc(len, opts);
+      must(r.is_ok());
+      b = cast(Block*, r.m.ptr);
+      b->size = r.m.len;
+
+      if (block_size < chain_arena_max_block_size) {
+        block_size <<= 1;
+      }
+    }
+
+    b->prev = block;
+    use(b);
+    pos = 0;
+    last = 0;
+  }
+
+  // Drop current block and make previous one current
+  method void drop() noexcept {
+    var Block* b = block;
+    use(b->prev);
+
+    if (spare == nil) {
+      spare = b;
+    } else if (spare->size < b->size) {
+      unmap(spare);
+      spare = b;
+    } else {
+      unmap(b);
+    }
+
+    // previous block was full when it was left, exact position
+    // is set by caller
+    pos = buf.len;
+    last = pos;
+  }
+
+  method void use(Block* b) noexcept {
+    block = b;
+    if (b == nil) {
+      buf = mc();
+      return;
+    }
+    buf = mc(cast(u8*, b) + sizeof(Block), b->size - sizeof(Block));
+  }
+
+  method void unmap(Block* b) noexcept {
+    const os::FreeResult r = os::free(mc(cast(u8*, b), b->size));
+    must(r.is_ok());
+  }
 };
 
-internal const uarch global_arena_size = 1 << 26;
-var global Arena arena = Arena(os::alloc(global_arena_size).m); // TODO: handle alloc error
+// Restores arena position when scope is exited, releasing all
+// allocations made inside the scope
+//
+// Arena type must provide save and restore methods
+template <typename A>
+struct Scope {
+  A* arena;
+
+  typename A::Checkpoint cp;
+
+  let Scope(A* a) noexcept : arena(a), cp(a->save()) {}
+
+  Scope(const Scope&) = delete;
+
+  ~Scope() noexcept { arena->restore(cp); }
+};
+
+// Size of the smallest chunk served by heap
+internal const uarch heap_min_class_size = 16;
+
+// Chunks bigger than this are mapped directly from OS
+internal const uarch heap_max_class_size = 1 << 16;
+
+// Number of size classes from heap_min_class_size to heap_max_class_size
+internal const uarch heap_class_count = 13;
+
+// Size of memory block which heap requests from OS for carving
+// small chunks
+internal const uarch heap_block_size = 1 << 20;
+
+fn internal inline constexpr uarch heap_class_size(uarch k) noexcept {
+  return heap_min_class_size << k;
+}
+
+// Chunks mapped from OS take whole pages, thus they are at least one
+// page longer than the biggest class. Typed chunks may cut their length
+// to a whole number of elements, length is rounded up to pages to find
+// out whether chunk is mapped. This works as long as elements are not
+// bigger than a page
+internal const uarch heap_page_size = 1 << 12;
+
+fn internal inline constexpr bool heap_is_mapped(uarch len) noexcept {
+  return bits::align_by_4kb(len) > heap_max_class_size;
+}
+
+// Returns index of the smallest size class which fits n bytes
+fn internal inline constexpr uarch heap_size_class(uarch n) noexcept {
+  if (n <= heap_min_class_size) {
+    return 0;
+  }
+  return 64 - 4 - bits::leading_zeros(cast(u64, n - 1));
+}
+
+// General purpose allocator
+//
+// Small chunks are served from power of two size classes. Each class
+// keeps a list of freed chunks, list links are stored inside chunks
+// themselves. New chunks are carved from blocks requested from OS.
+// Chunks bigger than the biggest class are mapped directly from OS
+// and grow by remapping their pages
+//
+// Class of a chunk is derived from its length, thus chunks must be
+// freed and reallocated with the length they were allocated with
+struct Heap {
+  struct FreeChunk {
+    FreeChunk* next;
+  };
+
+  // heads of free chunk lists for each size class
+  FreeChunk* free_lists[heap_class_count];
+
+  // part of current block which was not carved yet
+  mc block;
+
+  let constexpr Heap() noexcept : free_lists(), block() {}
+
+  // Allocate at least n bytes of memory
+  //
+  // Returns allocated memory chunk. Note that its length
+  // may be bigger than number of bytes requested
+  method mc alloc(uarch n) noexcept {
+    must(n != 0);
+
+    if (n > heap_max_class_size) {
+      const os::AllocResult r = os::alloc(n);
+      must(r.is_ok());
+      return r.m;
+    }
+
+    const uarch k = heap_size_class(n);
+    const uarch size = heap_class_size(k);
+
+    var FreeChunk* c = free_lists[k];
+    if (c != nil) {
+      free_lists[k] = c->next;
+      return mc(cast(u8*, c), size);
+    }
+
+    if (block.len < size) {
+      refill();
+    }
+
+    const mc m = block.slice_to(size);
+    block = block.slice_from(size);
+    return m;
+  }
+
+  method mc calloc(uarch n) noexcept {
+    var mc c = alloc(n);
+    c.clear();
+    return c;
+  }
+
+  // Grow memory chunk to at least n bytes. Chunk stays in place if
+  // its size class already fits n bytes
+  method mc realloc(mc c, uarch n) noexcept {
+    must(n > c.len);
+
+    if (c.is_nil()) {
+      return alloc(n);
+    }
+
+    if (heap_is_mapped(c.len)) {
+      const os::AllocResult r = os::realloc(mc(c.ptr, bits::align_by_4kb(c.len)), n);
+      must(r.is_ok());
+      return r.m;
+    }
+
+    const uarch size = heap_class_size(heap_size_class(c.len));
+    if (n <= size) {
+      return mc(c.ptr, size);
+    }
+
+    var mc c2 = alloc(n);
+    c2.unsafe_write(c);
+    free(c);
+    return c2;
+  }
+
+  method void free(mc c) noexcept {
+    if (c.is_nil()) {
+      return;
+    }
+
+    if (heap_is_mapped(c.len)) {
+      const os::FreeResult r = os::free(mc(c.ptr, bits::align_by_4kb(c.len)));
+      must(r.is_ok());
+      return;
+    }
+
+    push(heap_size_class(c.len), c.ptr);
+  }
+
+  method void push(uarch k, u8* p) noexcept {
+    var FreeChunk* c = cast(FreeChunk*, p);
+    c->next = free_lists[k];
+    free_lists[k] = c;
+  }
+
+  // Replace current block with a new one. Remainder of current block
+  // is split into chunks of smaller classes
+  method void refill() noexcept {
+    while (block.len >= heap_min_class_size) {
+      const uarch k = 63 - 4 - bits::leading_zeros(cast(u64, block.len));
+      push(k, block.ptr);
+      block = block.slice_from(heap_class_size(k));
+    }
+
+    const os::AllocResult r = os::alloc(heap_block_size);
+    must(r.is_ok());
+    block = r.m;
+  }
+};
+
+var global Heap heap;
 
 fn mc alloc(uarch n) noexcept {
-  return arena.alloc(n);
+  return heap.alloc(n);
 }
 
 template <typename T>
 fn chunk<T> alloc(uarch n) noexcept {
-  return arena.alloc<T>(n);
+  static_assert(sizeof(T) != 0);
+
+  const mc c = heap.alloc(chunk_size(T, n));
+
+  return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
 }
 
 fn mc calloc(uarch n) noexcept {
-  return arena.calloc(n);
+  return heap.calloc(n);
 }
 
 template <typename T>
 fn chunk<T> calloc(uarch n) noexcept {
-  return arena.calloc<T>(n);
+  static_assert(sizeof(T) != 0);
+
+  const mc c = heap.calloc(chunk_size(T, n));
+
+  return chunk<T>(cast(T*, c.ptr), c.len / sizeof(T));
 }
 
 fn mc realloc(mc c, uarch n) noexcept {
-  return arena.realloc(c, n);
+  return heap.realloc(c, n);
 }
 
 template <typename T>
 fn chunk<T> realloc(chunk<T> c, uarch n) noexcept {
-  return arena.realloc<T>(c, n);
+  static_assert(sizeof(T) != 0);
+  static_assert(sizeof(T) <= heap_page_size);
+
+  const mc c2 = heap.realloc(c.as_mc(), chunk_size(T, n));
+
+  return chunk<T>(cast(T*, c2.ptr), c2.len / sizeof(T));
 }
 
 fn void free(mc c) noexcept {
-  dummy_usage(c);
-  // arena.free(c);
+  heap.free(c);
 }
 
 template <typename T>
 fn void free(chunk<T> c) noexcept {
-  dummy_usage(c);
-  // arena.free<T>(c);
+  static_assert(sizeof(T) <= heap_page_size);
+
+  heap.free(c.as_mc());
+}
+
+// Size of memory slab which object pool maps from OS. Slabs are mapped
+// directly, so that caches of different threads can refill pool without
+// going through global heap
+internal const uarch pool_slab_size = 1 << 16;
+
+// Max number of free objects kept in pool cache, half of them are
+// returned to pool when cache overflows
+internal const uarch pool_cache_size = 64;
+
+// Slab header is padded to keep objects aligned
+internal const uarch pool_slab_header_size = 16;
+
+// Size of memory occupied by one object in pool slab. Freed slots
+// must fit a pointer
+template <typename T>
+fn internal inline constexpr uarch pool_slot_size() noexcept {
+  const uarch n = sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*);
+  const uarch a = alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+  return (n + a - 1) / a * a;
+}
+
+template <typename T>
+fn internal inline constexpr uarch pool_slab_size_for() noexcept {
+  const uarch n = pool_slab_header_size + pool_slot_size<T>();
+  return n > pool_slab_size ? bits::align_by_4kb(n) : pool_slab_size;
 }
 
+struct PoolStats {
+  // Number of slabs allocated by pool
+  uarch slabs;
+
+  // Number of objects which are currently allocated
+  uarch live;
+
+  // Max number of objects which were allocated at the same time
+  uarch peak;
+
+  // Total number of alloc calls
+  uarch allocs;
+
+  // Total number of free calls
+  uarch frees;
+};
+
+// Allocator for objects of type T
+//
+// Objects are carved from slabs mapped from OS. Freed objects are
+// kept in a list which links are stored inside objects themselves,
+// thus allocating and freeing an object takes constant time. Memory
+// is not returned to OS until pool is released
+//
+// Pool itself is not thread-safe. Threads which share a pool must
+// allocate and free objects only through their own caches (see Cache).
+// Objects held by caches are counted as live in pool stats
+template <typename T>
+struct Pool {
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  // Header placed at the start of each slab
+  struct Slab {
+    Slab* next;
+  };
+
+  static_assert(alignof(T) <= 16);
+
+  // list of freed objects
+  FreeSlot* free_slots;
+
+  // list of all slabs allocated by pool
+  Slab* slabs;
+
+  // part of current slab which was not carved yet
+  mc slab;
+
+  PoolStats stats;
+
+  // used by caches to access pool from different threads
+  u32 lock;
+
+  let constexpr Pool() noexcept : free_slots(nil), slabs(nil), slab(), stats(), lock(0) {}
+
+  // Allocate memory for one object. Object is not initialized
+  method T* alloc() noexcept {
+    stats.allocs += 1;
+    stats.live += 1;
+    if (stats.live > stats.peak) {
+      stats.peak = stats.live;
+    }
+
+    var FreeSlot* s = free_slots;
+    if (s != nil) {
+      free_slots = s->next;
+      return cast(T*, s);
+    }
+
+    if (slab.len < pool_slot_size<T>()) {
+      refill();
+    }
+
+    var T* p = cast(T*, slab.ptr);
+    slab = slab.slice_from(pool_slot_size<T>());
+    return p;
+  }
+
+  method void free(T* p) noexcept {
+    must(p != nil);
+    must(stats.live != 0);
+
+    stats.frees += 1;
+    stats.live -= 1;
+
+    var FreeSlot* s = cast(FreeSlot*, p);
+    s->next = free_slots;
+    free_slots = s;
+  }
+
+  method void refill() noexcept {
+    const os::AllocResult r = os::alloc(pool_slab_size_for<T>());
+    must(r.is_ok());
+    const mc m = r.m;
+
+    var Slab* h = cast(Slab*, m.ptr);
+    h->next = slabs;
+    slabs = h;
+    stats.slabs += 1;
+
+    slab = mc(m.ptr + pool_slab_header_size, pool_slab_size_for<T>() - pool_slab_header_size);
+  }
+
+  // Return all slabs to OS. All objects allocated from pool become
+  // invalid
+  method void release() noexcept {
+    while (slabs != nil) {
+      var Slab* h = slabs;
+      slabs = h->next;
+      const os::FreeResult r = os::free(mc(cast(u8*, h), pool_slab_size_for<T>()));
+      must(r.is_ok());
+    }
+
+    free_slots = nil;
+    slab = mc();
+    stats = PoolStats();
+  }
+
+  method void acquire_lock() noexcept {
+    while (__atomic_exchange_n(&lock, 1, __ATOMIC_ACQUIRE) != 0) {
+      while (__atomic_load_n(&lock, __ATOMIC_RELAXED) != 0) {
+      }
+    }
+  }
+
+  method void release_lock() noexcept { __atomic_store_n(&lock, 0, __ATOMIC_RELEASE); }
+
+  // Per-thread front of shared pool
+  //
+  // Cache keeps a small list of free objects which is used without
+  // locking. Pool is locked only when cache runs empty or overflows,
+  // objects are moved between cache and pool in batches
+  struct Cache {
+    Pool* pool;
+
+    // list of free objects owned by cache
+    FreeSlot* free_slots;
+
+    // number of objects in free list
+    uarch len;
+
+    let Cache(Pool* p) noexcept : pool(p), free_slots(nil), len(0) {}
+
+    method T* alloc() noexcept {
+      if (free_slots == nil) {
+        fill();
+      }
+
+      var FreeSlot* s = free_slots;
+      free_slots = s->next;
+      len -= 1;
+      return cast(T*, s);
+    }
+
+    method void free(T* p) noexcept {
+      must(p != nil);
+
+      var FreeSlot* s = cast(FreeSlot*, p);
+      s->next = free_slots;
+      free_slots = s;
+      len += 1;
+
+      if (len > pool_cache_size) {
+        drain(pool_cache_size / 2);
+      }
+    }
+
+    // Take half of cache capacity of objects from pool
+    method void fill() noexcept {
+      pool->acquire_lock();
+      for (uarch i = 0; i < pool_cache_size / 2; i += 1) {
+        var FreeSlot* s = cast(FreeSlot*, pool->alloc());
+        s->next = free_slots;
+        free_slots = s;
+      }
+      pool->release_lock();
+      len += pool_cache_size / 2;
+    }
+
+    // Return n objects from cache to pool
+    method void drain(uarch n) noexcept {
+      pool->acquire_lock();
+      for (uarch i = 0; i < n && free_slots != nil; i += 1) {
+        var FreeSlot* s = free_slots;
+        free_slots = s->next;
+        pool->free(cast(T*, s));
+        len -= 1;
+      }
+      pool->release_lock();
+    }
+
+    // Return all cached objects to pool. Must be called before
+    // thread which owns the cache exits
+    method void flush() noexcept { drain(len); }
+  };
+};
+
 } // namespace coven::mem
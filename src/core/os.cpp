@@ -135,4 +135,76 @@ struct OpenResult {
 // For implementation look into source file dedicated to specific OS
 fn OpenResult create(str path) noexcept;
 
+// Map entire file into memory for reading without copying its contents
+//
+// Returned data is a read-only private mapping backed directly by page
+// cache, thus memory usage and time spent inside this call do not depend
+// on file size. Pages are loaded lazily on first access. Mapping must be
+// released with free function when it is no longer needed
+//
+// Mapped file should not be truncated by other processes while mapping
+// is in use, otherwise accessing removed pages will crash the program
+//
+// For implementation look into source file dedicated to specific OS
+fn FileReadResult map_file(str path) noexcept;
+
+// Entry point of thread execution. Argument is passed to the function
+// as is from spawn call
+typedef void (*ThreadEntry)(void* arg);
+
+// Handle to a thread spawned by spawn function
+//
+// Threads share address space and file descriptors with the process,
+// but have their own small stack. Code executed inside spawned thread
+// must not use libc, global allocator or any other facilities which are
+// not thread-safe
+//
+// Handle must not be moved or copied while thread is running, because
+// OS reports thread completion by writing into handle memory
+struct Thread {
+  // Meaning of this value depends on specific OS. Equals zero when
+  // thread is not running
+  u32 id;
+
+  // memory used by thread stack
+  mc stack;
+
+  let Thread() noexcept : id(0), stack(mc()) {}
+};
+
+struct SpawnResult {
+  enum struct Code : u8 {
+    Ok = 0,
+
+    // Generic error, no specifics known
+    Error,
+
+    NoMemoryAvailable,
+  };
+
+  Code code;
+
+  let SpawnResult() noexcept : code(Code::Ok) {}
+  let SpawnResult(Code code) noexcept : code(code) {}
+
+  method bool is_ok() const noexcept { return code == Code::Ok; }
+  method bool is_err() const noexcept { return code != Code::Ok; }
+};
+
+// Start a new thread which executes entry(arg)
+//
+// For implementation look into source file dedicated to specific OS
+fn SpawnResult spawn(Thread* t, ThreadEntry entry, void* arg) noexcept;
+
+// Wait until thread finishes its execution and release its resources
+//
+// For implementation look into source file dedicated to specific OS
+fn void join(Thread* t) noexcept;
+
+// Returns number of CPU cores available to the process. Always
+// returns at least 1
+//
+// For implementation look into source file dedicated to specific OS
+fn uarch cpu_count() noexcept;
+
 } // namespace coven::os
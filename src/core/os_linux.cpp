@@ -237,7 +237,85 @@ fn AnonMmapSyscallResult anon_mmap(uptr addr, uarch len, u32 prot, u32 flags) no
 }
 
 fn inline AnonMmapSyscallResult alloc(uarch len) noexcept {
-  return anon_mmap(0, len, syscall::PROT_READ | syscall::PROT_WRITE, syscall::MAP_SHARED);
+  return anon_mmap(0, len, syscall::PROT_READ | syscall::PROT_WRITE, syscall::MAP_PRIVATE);
+}
+
+fn inline u32 anon_mmap_flags(os::AllocOptions opts) noexcept {
+  var u32 flags = syscall::MAP_PRIVATE;
+  if (opts.populate) {
+    flags |= syscall::MAP_POPULATE;
+  }
+  if (opts.noreserve) {
+    flags |= syscall::MAP_NORESERVE;
+  }
+  return flags;
+}
+
+// Map len bytes aligned by huge page size. Mapping is made one huge page
+// longer than needed and then unaligned head and tail are unmapped
+fn AnonMmapSyscallResult anon_mmap_huge(uarch len, u32 prot, u32 flags) noexcept {
+  const uarch n = len + os::huge_page_size;
+
+  // populating is deferred until unneeded pages are trimmed
+  const AnonMmapSyscallResult r = anon_mmap(0, n, prot, flags & ~syscall::MAP_POPULATE);
+  if (r.is_err()) {
+    return r;
+  }
+
+  const uptr addr = bits::align_by_2mb(r.addr);
+  const uarch head = addr - r.addr;
+  if (head != 0) {
+    must(syscall::munmap(r.addr, head).is_ok());
+  }
+  must(syscall::munmap(addr + len, os::huge_page_size - head).is_ok());
+
+  // advice fails if transparent huge pages are disabled in kernel,
+  // mapping is still usable with regular pages in that case
+  syscall::madvise(addr, len, syscall::MADV_HUGEPAGE);
+
+  if ((flags & syscall::MAP_POPULATE) != 0 && prot != syscall::PROT_NONE) {
+    // touch each page to fault it in, huge pages are allocated
+    // on first touch when advice succeeded
+    var u8* p = cast(u8*, addr);
+    for (uarch i = 0; i < len; i += 1 << 12) {
+      p[i] = 0;
+    }
+  }
+
+  return AnonMmapSyscallResult(addr);
+}
+
+// Open file at given path and map its contents into memory as read-only
+// private mapping. File descriptor is closed right after mapping is
+// established, because mapping keeps its own reference to the file
+fn os::FileReadResult map_file(cstr path) noexcept {
+  const OpenSyscallResult r = open(path, cast(u32, syscall::OpenFlags::O_RDONLY), 0);
+  if (r.is_err()) {
+    return os::FileReadResult(os::FileReadResult::Code::Error);
+  }
+  const u32 fd = cast(u32, r.fd.val);
+
+  var syscall::Stat stat dirty;
+  const syscall::Result sr = syscall::fstat(fd, &stat);
+  if (sr.is_err()) {
+    close(r.fd);
+    return os::FileReadResult(os::FileReadResult::Code::Error);
+  }
+
+  const uarch size = stat.size;
+  if (size == 0) {
+    // empty file cannot be mapped, nothing to read
+    close(r.fd);
+    return os::FileReadResult(mc());
+  }
+
+  const syscall::Result mr = syscall::mmap(0, size, syscall::PROT_READ, syscall::MAP_PRIVATE, fd, 0);
+  close(r.fd);
+  if (mr.is_err()) {
+    return os::FileReadResult(os::FileReadResult::Code::Error);
+  }
+
+  return os::FileReadResult(mc(cast(u8*, mr.val), size));
 }
 
 }  // namespace coven::os::linux
@@ -255,6 +333,163 @@ fn AllocResult alloc(uarch n) noexcept {
   return AllocResult(r.code);
 }
 
+fn AllocResult alloc(uarch n, AllocOptions opts) noexcept {
+  const u32 prot = linux::syscall::PROT_READ | linux::syscall::PROT_WRITE;
+  const u32 flags = linux::anon_mmap_flags(opts);
+
+  if (opts.huge_pages) {
+    const uarch len = bits::align_by_2mb(n);
+    const linux::AnonMmapSyscallResult r = linux::anon_mmap_huge(len, prot, flags);
+    if (r.is_ok()) {
+      return AllocResult(mc(cast(u8*, r.addr), len));
+    }
+    return AllocResult(r.code);
+  }
+
+  const uarch len = bits::align_by_4kb(n);
+  const linux::AnonMmapSyscallResult r = linux::anon_mmap(0, len, prot, flags);
+  if (r.is_ok()) {
+    return AllocResult(mc(cast(u8*, r.addr), len));
+  }
+
+  return AllocResult(r.code);
+}
+
+fn AllocResult reserve(uarch n, AllocOptions opts) noexcept {
+  const u32 prot = linux::syscall::PROT_NONE;
+
+  // reserved pages cannot be prefaulted, they are inaccessible
+  // until committed
+  opts.populate = false;
+  opts.noreserve = true;
+  const u32 flags = linux::anon_mmap_flags(opts);
+
+  if (opts.huge_pages) {
+    const uarch len = bits::align_by_2mb(n);
+    const linux::AnonMmapSyscallResult r = linux::anon_mmap_huge(len, prot, flags);
+    if (r.is_ok()) {
+      return AllocResult(mc(cast(u8*, r.addr), len));
+    }
+    return AllocResult(r.code);
+  }
+
+  const uarch len = bits::align_by_4kb(n);
+  const linux::AnonMmapSyscallResult r = linux::anon_mmap(0, len, prot, flags);
+  if (r.is_ok()) {
+    return AllocResult(mc(cast(u8*, r.addr), len));
+  }
+
+  return AllocResult(r.code);
+}
+
+fn AllocResult commit(mc c, AllocOptions opts) noexcept {
+  const uptr addr = cast(uptr, c.ptr);
+  must((addr & 0xFFF) == 0);
+  must((c.len & 0xFFF) == 0);
+
+  const linux::syscall::Result r =
+      linux::syscall::mprotect(addr, c.len, linux::syscall::PROT_READ | linux::syscall::PROT_WRITE);
+  if (r.is_err()) {
+    return AllocResult(AllocResult::Code::NoMemoryAvailable);
+  }
+
+  if (opts.populate) {
+    for (uarch i = 0; i < c.len; i += 1 << 12) {
+      c.ptr[i] = 0;
+    }
+  }
+
+  return AllocResult(c);
+}
+
+fn AllocResult realloc(mc c, uarch n) noexcept {
+  const uarch len = bits::align_by_4kb(n);
+  const linux::syscall::Result r =
+      linux::syscall::mremap(cast(uptr, c.ptr), c.len, len, linux::syscall::MREMAP_MAYMOVE);
+
+  if (r.is_ok()) {
+    return AllocResult(mc(cast(u8*, r.val), len));
+  }
+
+  return AllocResult(AllocResult::Code::NoMemoryAvailable);
+}
+
+fn FreeResult free(mc c) noexcept {
+  if (c.is_nil()) {
+    return FreeResult();
+  }
+
+  const linux::syscall::Result r = linux::syscall::munmap(cast(uptr, c.ptr), c.len);
+  if (r.is_ok()) {
+    return FreeResult();
+  }
+
+  return FreeResult(FreeResult::Code::Error);
+}
+
+// Size of memory allocated for stack of each spawned thread
+internal const uarch thread_stack_size = 1 << 16;
+
+fn SpawnResult spawn(Thread* t, ThreadEntry entry, void* arg) noexcept {
+  const AllocResult a = alloc(thread_stack_size);
+  if (a.m.is_nil()) {
+    return SpawnResult(SpawnResult::Code::NoMemoryAvailable);
+  }
+  t->stack = a.m;
+
+  // Kernel stores thread id into handle before clone3 returns and
+  // clears it (waking up futex waiters) when thread exits
+  var linux::syscall::CloneArgs args = {};
+  args.flags = linux::syscall::CLONE_VM | linux::syscall::CLONE_FS | linux::syscall::CLONE_FILES |
+               linux::syscall::CLONE_SIGHAND | linux::syscall::CLONE_THREAD |
+               linux::syscall::CLONE_SYSVSEM | linux::syscall::CLONE_PARENT_SETTID |
+               linux::syscall::CLONE_CHILD_CLEARTID;
+  args.child_tid = cast(u64, &t->id);
+  args.parent_tid = cast(u64, &t->id);
+  args.stack = cast(u64, a.m.ptr);
+  args.stack_size = a.m.len;
+
+  const linux::syscall::Result r = linux::syscall::clone3_thread(&args, entry, arg);
+  if (r.is_err()) {
+    free(t->stack);
+    t->stack = mc();
+    t->id = 0;
+    return SpawnResult(SpawnResult::Code::Error);
+  }
+
+  return SpawnResult();
+}
+
+fn void join(Thread* t) noexcept {
+  while (true) {
+    const u32 id = __atomic_load_n(&t->id, __ATOMIC_ACQUIRE);
+    if (id == 0) {
+      break;
+    }
+    linux::syscall::futex_wait(&t->id, id);
+  }
+
+  free(t->stack);
+  t->stack = mc();
+}
+
+fn uarch cpu_count() noexcept {
+  var u8 mask[128] = {};
+  const linux::syscall::Result r = linux::syscall::sched_getaffinity(0, mc(mask, sizeof(mask)));
+  if (r.is_err()) {
+    return 1;
+  }
+
+  var uarch n = 0;
+  for (uarch i = 0; i < r.val; i += 1) {
+    n += bits::pop_count(mask[i]);
+  }
+  if (n == 0) {
+    return 1;
+  }
+  return n;
+}
+
 fn io::ReadResult read(FileStream stream, mc c) noexcept {
   const linux::FileDescriptor fd = linux::FileDescriptor(stream.handle);
   return linux::read(fd, c);
@@ -265,6 +500,11 @@ fn io::WriteResult write(FileStream stream, mc c) noexcept {
   return linux::write(fd, c);
 }
 
+fn io::CloseResult close(FileStream stream) noexcept {
+  const linux::FileDescriptor fd = linux::FileDescriptor(stream.handle);
+  return linux::close(fd);
+}
+
 fn internal inline FileStream convert_to_file_stream(linux::FileDescriptor fd) noexcept {
   return FileStream(fd.val);
 }
@@ -366,6 +606,19 @@ fn OpenResult create(str path) noexcept {
   return convert_to_open_result(linux::create(path_as_cstr));
 }
 
+fn FileReadResult map_file(str path) noexcept {
+  const uarch path_buf_length = 1 << 14;
+  if (path.len >= path_buf_length) {
+    return FileReadResult(FileReadResult::Code::PathTooLong);
+  }
+
+  var u8 buf[path_buf_length] dirty;
+  var mc path_buf = mc(buf, path_buf_length);
+  var cstr path_as_cstr = unsafe_copy_as_cstr(path, path_buf);
+
+  return linux::map_file(path_as_cstr);
+}
+
 // Read entire file and return its contents as raw bytes
 //
 // Memory allocations are performed via supplied allocator
@@ -39,7 +39,7 @@
 #define bit_cast(T, x) __builtin_bit_cast(T, x)
 
 // Compute chunk size in bytes to hold n elements of type T
-#define chunk_size(T, n) (n * sizeof(T))
+#define chunk_size(T, n) ((n) * sizeof(T))
 
 namespace coven {
 
@@ -112,7 +112,7 @@ fn [[noreturn]] internal inline void crash() noexcept {
 }
 
 // Basic assert function. If condition is not met crashes the program
-fn internal inline void must(bool condition) noexcept {
+fn internal inline constexpr void must(bool condition) noexcept {
   if (condition) {
     return;
   }
@@ -134,6 +134,10 @@ fn void copy(u8* restrict src, u8* restrict dst, uarch n) noexcept;
 // must be greater than zero
 //
 // Guarantees correct behaviour for overlapping memory regions
-fn void move(u8* restrict src, u8* dst, iarch n) noexcept;
+fn void move(u8* restrict src, u8* dst, uarch n) noexcept;
+
+// Sets n bytes of memory starting from dst to value x. Number of
+// bytes must be greater than zero
+fn void fill(u8* dst, u8 x, uarch n) noexcept;
 
 } // namespace coven::mem
@@ -18,6 +18,15 @@ extern "C" fn uptr coven_linux_syscall_anon_mmap(uptr addr,
 
 extern "C" fn i32 coven_linux_syscall_munmap(uptr addr, uarch len) noexcept;
 
+extern "C" fn uptr coven_linux_syscall_mremap(uptr addr,
+                                              uarch old_len,
+                                              uarch new_len,
+                                              u32 flags) noexcept;
+
+extern "C" fn i32 coven_linux_syscall_mprotect(uptr addr, uarch len, u32 prot) noexcept;
+
+extern "C" fn i32 coven_linux_syscall_madvise(uptr addr, uarch len, u32 advice) noexcept;
+
 // First argument must be a null-terminated string with path to file
 extern "C" fn i32 coven_linux_syscall_open(const u8* path,
                                            u32 flags,
@@ -133,6 +142,14 @@ struct CloneArgs {
 
 extern "C" fn i32 coven_linux_syscall_clone3(CloneArgs* args) noexcept;
 
+// Create a thread which executes entry(arg) and exits when it returns.
+// Stack for the thread must be specified in args
+extern "C" fn i32 coven_linux_syscall_clone3_thread(CloneArgs* args,
+                                                    void (*entry)(void* arg),
+                                                    void* arg) noexcept;
+
+extern "C" fn i32 coven_linux_syscall_sched_getaffinity(u32 pid, uarch len, u8* mask) noexcept;
+
 enum struct Error : u32 {
   OK = 0,
 
@@ -744,12 +761,20 @@ fn inline Result mkdir(const u8* path, u32 mode) noexcept {
 //         MAP_DENYWRITE was set but the object specified by fd is open for writing.
 
 
+const u32 PROT_NONE = 0x0;
 const u32 PROT_READ = 0x1;
 const u32 PROT_WRITE = 0x2;
 
 const u32 MAP_SHARED = 0x01;
+const u32 MAP_PRIVATE = 0x02;
 const u32 MAP_ANONYMOUS = 0x20;
 
+// Do not reserve swap space for the mapping
+const u32 MAP_NORESERVE = 0x4000;
+
+// Prefault page tables of the mapping
+const u32 MAP_POPULATE = 0x8000;
+
 fn inline Result anon_mmap(uptr addr, uarch len, u32 prot, u32 flags) noexcept {
   const uptr r = coven_linux_syscall_anon_mmap(addr, len, prot, flags | MAP_ANONYMOUS);
 
@@ -761,4 +786,141 @@ fn inline Result anon_mmap(uptr addr, uarch len, u32 prot, u32 flags) noexcept {
   return Result(r);
 }
 
+// Map len bytes of file (specified by descriptor) into memory starting
+// from given offset. Result value carries address of the mapping
+fn inline Result mmap(uptr addr, uarch len, u32 prot, u32 flags, u32 fd, i32 offset) noexcept {
+  const uptr r = coven_linux_syscall_mmap(addr, len, prot, flags, fd, offset);
+
+  const iarch error_check = -cast(iarch, r);
+  if (0 < error_check && error_check < 256) {
+    return Result(cast(Error, error_check));
+  }
+
+  return Result(r);
+}
+
+// Mapping may be moved to another address if it cannot be expanded
+// at its current location
+const u32 MREMAP_MAYMOVE = 0x1;
+
+// Resize existing mapping. Result value carries address of the mapping,
+// which may differ from the old one if MREMAP_MAYMOVE flag was given
+fn inline Result mremap(uptr addr, uarch old_len, uarch new_len, u32 flags) noexcept {
+  const uptr r = coven_linux_syscall_mremap(addr, old_len, new_len, flags);
+
+  const iarch error_check = -cast(iarch, r);
+  if (0 < error_check && error_check < 256) {
+    return Result(cast(Error, error_check));
+  }
+
+  return Result(r);
+}
+
+// Change access protection of pages in given range
+fn inline Result mprotect(uptr addr, uarch len, u32 prot) noexcept {
+  const i32 r = coven_linux_syscall_mprotect(addr, len, prot);
+  if (r == 0) {
+    return Result();
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+// Enable transparent huge pages for the range
+const u32 MADV_HUGEPAGE = 14;
+
+// Give the kernel a hint about expected usage of pages in given range
+fn inline Result madvise(uptr addr, uarch len, u32 advice) noexcept {
+  const i32 r = coven_linux_syscall_madvise(addr, len, advice);
+  if (r == 0) {
+    return Result();
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+const u64 CLONE_VM = 0x100;
+const u64 CLONE_FS = 0x200;
+const u64 CLONE_FILES = 0x400;
+const u64 CLONE_SIGHAND = 0x800;
+const u64 CLONE_THREAD = 0x10000;
+const u64 CLONE_SYSVSEM = 0x40000;
+const u64 CLONE_PARENT_SETTID = 0x100000;
+const u64 CLONE_CHILD_CLEARTID = 0x200000;
+
+const i32 FUTEX_WAIT = 0;
+const i32 FUTEX_WAKE = 1;
+
+fn inline Result clone3_thread(CloneArgs* args, void (*entry)(void* arg), void* arg) noexcept {
+  const i32 r = coven_linux_syscall_clone3_thread(args, entry, arg);
+  if (r >= 0) {
+    return Result(cast(uarch, r));
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+// Sleep while value at addr equals val. May return spuriously
+fn inline Result futex_wait(u32* addr, u32 val) noexcept {
+  const i32 r = coven_linux_syscall_futex(addr, FUTEX_WAIT, val, nil, nil, 0);
+  if (r == 0) {
+    return Result();
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+// Wake at most n threads waiting on addr. Result value carries number
+// of woken up threads
+fn inline Result futex_wake(u32* addr, u32 n) noexcept {
+  const i32 r = coven_linux_syscall_futex(addr, FUTEX_WAKE, n, nil, nil, 0);
+  if (r >= 0) {
+    return Result(cast(uarch, r));
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+// Result value carries number of bytes written into mask
+fn inline Result sched_getaffinity(u32 pid, mc mask) noexcept {
+  const i32 r = coven_linux_syscall_sched_getaffinity(pid, mask.len, mask.ptr);
+  if (r >= 0) {
+    return Result(cast(uarch, r));
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+fn inline Result munmap(uptr addr, uarch len) noexcept {
+  const i32 r = coven_linux_syscall_munmap(addr, len);
+  if (r == 0) {
+    return Result();
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
+//  EBADF  fd is not a valid open file descriptor.
+//  EFAULT Bad address.
+//  ENOMEM Out of memory (i.e., kernel memory).
+//  EOVERFLOW
+//         pathname or fd refers to a file whose size, inode number, or number of blocks cannot be represented in,
+//         respectively, the types off_t, ino_t, or blkcnt_t.
+fn inline Result fstat(u32 fd, Stat* stat) noexcept {
+  const i32 r = coven_linux_syscall_fstat(fd, stat);
+  if (r == 0) {
+    return Result();
+  }
+
+  const Error err = cast(Error, -r);
+  return Result(err);
+}
+
 }  // namespace coven::os::linux::syscall
@@ -2,9 +2,19 @@ SYS_READ   = 0x00
 SYS_WRITE  = 0x01
 SYS_OPEN   = 0x02
 SYS_CLOSE  = 0x03
+SYS_FSTAT  = 0x05
 SYS_MMAP   = 0x09
+SYS_MPROTECT = 0x0a
 SYS_MUNMAP = 0x0b
+SYS_MREMAP = 0x19
+SYS_MADVISE = 0x1c
 SYS_EXIT   = 0x3c
+SYS_FUTEX  = 0xca
+SYS_SCHED_GETAFFINITY = 0xcc
+SYS_CLONE3 = 0x1b3
+
+// Size of clone_args structure passed to clone3 syscall
+CLONE_ARGS_SIZE = 0x58
 
 .section .text
 
@@ -13,9 +23,17 @@ SYS_EXIT   = 0x3c
 .global coven_linux_syscall_anon_mmap
 .global coven_linux_syscall_mmap
 .global coven_linux_syscall_munmap
+.global coven_linux_syscall_mremap
+.global coven_linux_syscall_mprotect
+.global coven_linux_syscall_madvise
 .global coven_linux_syscall_read
 .global coven_linux_syscall_write
 .global coven_linux_syscall_close
+.global coven_linux_syscall_fstat
+.global coven_linux_syscall_futex
+.global coven_linux_syscall_sched_getaffinity
+.global coven_linux_syscall_clone3
+.global coven_linux_syscall_clone3_thread
 
 // Brief summary of syscall convetions on linux_amd64 platform
 //
@@ -157,6 +175,65 @@ coven_linux_syscall_munmap:
     syscall
     ret
 
+// fn mremap(addr: uptr, old_len: uarch, new_len: uarch, flags: u32) => uptr
+//
+//  [addr]    => rdi
+//  [old_len] => rsi
+//  [new_len] => rdx
+//  [flags]   => rcx
+coven_linux_syscall_mremap:
+    // All arguments except flags are already set in place for syscall
+    // by function calling convention
+    //
+    // Move flags argument into syscall arg3 register (r10)
+    mov %rcx, %r10
+
+    // mremap syscall number => 0x19 => rax
+    //
+    //  [addr]    => arg0 => rdi
+    //  [old_len] => arg1 => rsi
+    //  [new_len] => arg2 => rdx
+    //  [flags]   => arg3 => r10
+    mov $SYS_MREMAP, %rax
+    syscall
+    ret
+
+// fn mprotect(addr: uptr, len: uarch, prot: u32) => i32
+//
+//  [addr] => rdi
+//  [len]  => rsi
+//  [prot] => rdx
+coven_linux_syscall_mprotect:
+    // All arguments are already set in place for syscall by function
+    // calling convention
+    //
+    // mprotect syscall number => 0x0A => rax
+    //
+    //  [addr] => arg0 => rdi
+    //  [len]  => arg1 => rsi
+    //  [prot] => arg2 => rdx
+    mov $SYS_MPROTECT, %rax
+    syscall
+    ret
+
+// fn madvise(addr: uptr, len: uarch, advice: u32) => i32
+//
+//  [addr]   => rdi
+//  [len]    => rsi
+//  [advice] => rdx
+coven_linux_syscall_madvise:
+    // All arguments are already set in place for syscall by function
+    // calling convention
+    //
+    // madvise syscall number => 0x1C => rax
+    //
+    //  [addr]   => arg0 => rdi
+    //  [len]    => arg1 => rsi
+    //  [advice] => arg2 => rdx
+    mov $SYS_MADVISE, %rax
+    syscall
+    ret
+
 // fn read(fd: u32, buf: *u8, len: uarch) => i32
 //
 //  [fd]  => rdi
@@ -202,3 +279,122 @@ coven_linux_syscall_close:
     mov $SYS_CLOSE, %rax
     syscall
     ret
+
+// fn fstat(fd: u32, stat: *Stat) => i32
+coven_linux_syscall_fstat:
+    // All arguments are already set in place for syscall by function
+    // calling convention
+    //
+    // fstat syscall number => 0x05 => rax
+    //
+    //  [fd]   => arg0 => rdi
+    //  [stat] => arg1 => rsi
+    mov $SYS_FSTAT, %rax
+    syscall
+    ret
+
+// fn futex(addr: *u32, op: i32, val: u32, timeout: *Timespec, addr2: *u32, val3: u32) => i32
+//
+//  [addr]    => rdi
+//  [op]      => rsi
+//  [val]     => rdx
+//  [timeout] => rcx
+//  [addr2]   => r8
+//  [val3]    => r9
+coven_linux_syscall_futex:
+    // All arguments except [timeout] are already set in place for syscall
+    // by function calling convention
+    //
+    // Move timeout argument into syscall arg3 register (r10)
+    mov %rcx, %r10
+
+    // futex syscall number => 0xCA => rax
+    //
+    //  [addr]    => arg0 => rdi
+    //  [op]      => arg1 => rsi
+    //  [val]     => arg2 => rdx
+    //  [timeout] => arg3 => r10
+    //  [addr2]   => arg4 => r8
+    //  [val3]    => arg5 => r9
+    mov $SYS_FUTEX, %rax
+    syscall
+    ret
+
+// fn sched_getaffinity(pid: u32, len: uarch, mask: *u8) => i32
+//
+//  [pid]  => rdi
+//  [len]  => rsi
+//  [mask] => rdx
+coven_linux_syscall_sched_getaffinity:
+    // All arguments are already set in place for syscall by function
+    // calling convention
+    //
+    // sched_getaffinity syscall number => 0xCC => rax
+    //
+    //  [pid]  => arg0 => rdi
+    //  [len]  => arg1 => rsi
+    //  [mask] => arg2 => rdx
+    mov $SYS_SCHED_GETAFFINITY, %rax
+    syscall
+    ret
+
+// fn clone3(args: *CloneArgs) => i32
+//
+//  [args] => rdi
+coven_linux_syscall_clone3:
+    // clone3 syscall number => 0x1B3 => rax
+    //
+    //  [args] => arg0 => rdi
+    //  [size] => arg1 => rsi
+    mov $CLONE_ARGS_SIZE, %rsi
+    mov $SYS_CLONE3, %rax
+    syscall
+    ret
+
+// fn clone3_thread(args: *CloneArgs, entry: fn(*void), arg: *void) => i32
+//
+//  [args]  => rdi
+//  [entry] => rsi
+//  [arg]   => rdx
+//
+// Creates a thread which runs entry(arg) on the stack specified in args
+// and exits right after entry returns. Parent receives child thread id
+// (or negated error code) as a result
+coven_linux_syscall_clone3_thread:
+    // Child starts executing right after syscall instruction with the
+    // same register values as parent, but on a new stack. Entry and its
+    // argument are carried over to child in callee-saved registers,
+    // their previous values are saved on parent stack
+    push %r12
+    push %r13
+    mov %rsi, %r12
+    mov %rdx, %r13
+
+    // clone3 syscall number => 0x1B3 => rax
+    //
+    //  [args] => arg0 => rdi
+    //  [size] => arg1 => rsi
+    mov $CLONE_ARGS_SIZE, %rsi
+    mov $SYS_CLONE3, %rax
+    syscall
+
+    test %rax, %rax
+    jz clone3_thread_child
+
+    // parent (or error)
+    pop %r13
+    pop %r12
+    ret
+
+clone3_thread_child:
+    // Stack pointer of child is set by kernel to the top of its stack.
+    // Stack top is 16-byte aligned, thus call below satisfies function
+    // call alignment requirements
+    xor %rbp, %rbp
+    mov %r13, %rdi
+    call *%r12
+
+    // exit syscall terminates only calling thread
+    xor %rdi, %rdi
+    mov $SYS_EXIT, %rax
+    syscall
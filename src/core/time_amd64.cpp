@@ -5,7 +5,9 @@ fn u64 clock() noexcept {
   var u32 lo;
   var u32 id;
 
-  asm(R"(
+  // volatile keeps compiler from merging or hoisting clock reads,
+  // since asm has no inputs it would otherwise be treated as pure
+  asm volatile(R"(
     rdtscp
   )"
       : "=d"(hi), "=a"(lo), "=c"(id));
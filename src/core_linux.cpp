@@ -89,6 +89,96 @@ fn FileReadResult read_file(str filename) noexcept {
   return FileReadResult(data.slice_to(rr.n));
 }
 
+// Replaces file at path to with file at path from. Replacement is atomic
+// when both paths are on the same filesystem
+//
+// Returns false if operation fails
+fn bool rename(str from, str to) noexcept {
+  const usz path_buf_length = 1 << 12;
+  if (from.len >= path_buf_length || to.len >= path_buf_length) {
+    return false;
+  }
+
+  var u8 from_buf[path_buf_length] dirty;
+  var cstr from_path = unsafe_copy_as_cstr(from, mc(from_buf, from.len + 1));
+  var u8 to_buf[path_buf_length] dirty;
+  var cstr to_path = unsafe_copy_as_cstr(to, mc(to_buf, to.len + 1));
+
+  return ::rename(cast(char*, from_path.ptr), cast(char*, to_path.ptr)) == 0;
+}
+
+// Returns false if file cannot be removed
+fn bool remove(str filename) noexcept {
+  const usz path_buf_length = 1 << 12;
+  if (filename.len >= path_buf_length) {
+    return false;
+  }
+
+  var u8 path_buf[path_buf_length] dirty;
+  var cstr path = unsafe_copy_as_cstr(filename, mc(path_buf, filename.len + 1));
+
+  return ::unlink(cast(char*, path.ptr)) == 0;
+}
+
+// Returns path of file which filename refers to after following all
+// symlinks, resolved path is placed into supplied buffer. Path of file
+// which does not exist yet is returned as is
+//
+// Returns empty string if path cannot be resolved
+fn str resolve(str filename, mc buf) noexcept {
+  const usz path_buf_length = 1 << 12;
+  if (filename.len >= path_buf_length || buf.len < path_buf_length) {
+    return str();
+  }
+
+  var u8 path_buf[path_buf_length] dirty;
+  var cstr path = unsafe_copy_as_cstr(filename, mc(path_buf, filename.len + 1));
+
+  var struct stat s dirty;
+  if (lstat(cast(char*, path.ptr), &s) < 0) {
+    if (errno == ENOENT) {
+      return filename;
+    }
+    return str();
+  }
+
+  const char* r = realpath(cast(char*, path.ptr), cast(char*, buf.ptr));
+  if (r == nil) {
+    return str();
+  }
+  return str(buf.ptr, strlen(r));
+}
+
+// Applies permission bits of file at path from to file fd. Nothing is
+// applied if file at path from does not exist
+//
+// Returns false if operation fails
+fn bool copy_mode(str from, Stream fd) noexcept {
+  const usz path_buf_length = 1 << 12;
+  if (from.len >= path_buf_length) {
+    return false;
+  }
+
+  var u8 path_buf[path_buf_length] dirty;
+  var cstr path = unsafe_copy_as_cstr(from, mc(path_buf, from.len + 1));
+
+  var struct stat s dirty;
+  if (stat(cast(char*, path.ptr), &s) < 0) {
+    return errno == ENOENT;
+  }
+  return fchmod(cast(i32, fd), s.st_mode & 07777) == 0;
+}
+
+// Flushes file contents to storage device and closes file. Descriptor
+// is closed even if flush fails
+//
+// Returns false if either of the steps fails
+fn bool sync_and_close(Stream fd) noexcept {
+  const bool synced = fsync(cast(i32, fd)) == 0;
+  const bool closed = ::close(cast(i32, fd)) == 0;
+  return synced && closed;
+}
+
 }  // namespace fs
 
 
@@ -34,6 +34,18 @@ fn DynBuffer<IndexedWord> split_and_index_words(str text) noexcept {
   return buf;
 }
 
+// Number of seeds tried for each capacity before moving on to the next one
+internal const u64 seed_budget = 1 << 20;
+
+// Largest table capacity considered by search
+internal const uarch max_cap = 1 << 24;
+
+// Capacity is skipped without trying any seeds when probability of
+// a random seed placing all words without collisions is below exp(-x).
+// Birthday bound gives probability close to exp(-n * (n - 1) / (2 * cap)),
+// seed budget of 2**20 (about exp(14)) rarely finds a seed beyond exp(-16)
+internal const uarch hopeless_exponent = 16;
+
 struct CapSeedPair {
   u64 seed;
   uarch cap;
@@ -41,54 +53,367 @@ struct CapSeedPair {
   bool ok;
 };
 
+// Search state shared by all threads which try seeds
+// for the same table capacity
+struct SeedSearch {
+  chunk<IndexedWord> words;
+
+  uarch cap;
+
+  // Smallest fitting seed found so far. Equals seed budget
+  // until some seed is found
+  u64 best;
+
+  // Number of threads taking part in search. Thread k tries
+  // seeds k, k + threads, k + 2 * threads and so on
+  uarch threads;
+};
+
+struct SeedWorker {
+  os::Thread thread;
+
+  SeedSearch* search;
+
+  // Marks occupied table slots. Slot is occupied during attempt number
+  // k if its stamp equals k, thus there is no need to clear anything
+  // between attempts
+  chunk<u32> stamps;
+
+  // first seed tried by this worker
+  u64 first;
+
+  // number of seeds tried by this worker
+  u64 attempts;
+};
+
+// Returns true if all words land in distinct slots when hashed with
+// given seed. Stops as soon as first collision is found
+fn internal bool fits(chunk<IndexedWord> words, uarch mask, u64 seed, u32* stamps, u32 stamp) noexcept {
+  for (uarch i = 0; i < words.len; i += 1) {
+    const uarch pos = hash::map::compute(seed, words.ptr[i].key) & mask;
+    if (stamps[pos] == stamp) {
+      return false;
+    }
+    stamps[pos] = stamp;
+  }
+  return true;
+}
+
+// Lower best seed of search to the given one unless some
+// other thread already found a smaller one
+fn internal void offer_seed(SeedSearch* s, u64 seed) noexcept {
+  var u64 best = __atomic_load_n(&s->best, __ATOMIC_RELAXED);
+  while (seed < best) {
+    if (__atomic_compare_exchange_n(&s->best, &best, seed, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+}
+
+// Tries seeds in increasing order until a fitting one is found or another
+// thread finds a smaller seed. Thus search always ends with the smallest
+// fitting seed regardless of how many threads take part in it
+fn internal void search_seeds(void* arg) noexcept {
+  var SeedWorker* w = cast(SeedWorker*, arg);
+  const SeedSearch* s = w->search;
+  const uarch mask = s->cap - 1;
+
+  var u32 stamp = 0;
+  for (u64 seed = w->first; seed < seed_budget; seed += s->threads) {
+    if (seed >= __atomic_load_n(&s->best, __ATOMIC_RELAXED)) {
+      return;
+    }
+
+    stamp += 1;
+    w->attempts += 1;
+    if (fits(s->words, mask, seed, w->stamps.ptr, stamp)) {
+      offer_seed(w->search, seed);
+      return;
+    }
+  }
+}
+
+fn internal bool is_hopeless(uarch n, uarch cap) noexcept {
+  return n * (n - 1) / (2 * cap) > hopeless_exponent;
+}
+
+// Writes number of elapsed cycles in millions
+fn internal void write_mcycles(fmt::Buffer* buf, u64 cycles) noexcept {
+  buf->dec(cycles / 1000000);
+  buf->write(static_string(" Mcycles"));
+}
+
+// Search seed for a single capacity using all available cores
+fn internal CapSeedPair search_cap(chunk<IndexedWord> words, uarch cap, chunk<SeedWorker> workers) noexcept {
+  var SeedSearch search = SeedSearch{
+      .words = words,
+      .cap = cap,
+      .best = seed_budget,
+      .threads = workers.len,
+  };
+
+  for (uarch k = 0; k < workers.len; k += 1) {
+    var SeedWorker* w = workers.ptr + k;
+    w->thread = os::Thread();
+    w->search = &search;
+    w->stamps = mem::calloc<u32>(cap);
+    w->first = k;
+    w->attempts = 0;
+  }
+
+  // first worker runs on calling thread
+  for (uarch k = 1; k < workers.len; k += 1) {
+    var SeedWorker* w = workers.ptr + k;
+    const os::SpawnResult r = os::spawn(&w->thread, search_seeds, w);
+    must(r.is_ok());
+  }
+  search_seeds(workers.ptr);
+  for (uarch k = 1; k < workers.len; k += 1) {
+    os::join(&workers.ptr[k].thread);
+  }
+
+  for (uarch k = 0; k < workers.len; k += 1) {
+    mem::free(workers.ptr[k].stamps);
+  }
+
+  if (search.best == seed_budget) {
+    return CapSeedPair{.seed = 0, .cap = cap, .ok = false};
+  }
+  return CapSeedPair{.seed = search.best, .cap = cap, .ok = true};
+}
+
+// Sweeps table capacities (powers of 2) starting from the smallest one
+// which can hold all words and returns the first capacity for which
+// a fitting seed was found. Progress of each step is reported to stdout
 fn CapSeedPair find_best_cap_and_seed(chunk<IndexedWord> words) noexcept {
-  var uarch cap = words.len << 1;
-  cap = bits::upper_power_of_two(cast(u32, cap));
+  const chunk<SeedWorker> block = mem::alloc<SeedWorker>(os::cpu_count());
+  const chunk<SeedWorker> workers = chunk<SeedWorker>(block.ptr, os::cpu_count());
 
-  var cont::FlatMap<uarch> m =
-      cont::fit_into_flat_map<uarch>(cap, cap - 1, words);
+  var u8 scratch[256] dirty;
+  var fmt::Buffer buf = fmt::Buffer(scratch, sizeof(scratch));
 
-  if (m.len == 0) {
-    return CapSeedPair{.seed = 0, .cap = 0, .ok = false};
+  const uarch n = words.len;
+  var uarch cap = bits::upper_power_of_two(cast(u32, n + 1));
+  for (; cap <= max_cap; cap <<= 1) {
+    buf.reset();
+    buf.write(static_string("cap "));
+    buf.dec(cap);
+    buf.write(static_string(": "));
+
+    if (is_hopeless(n, cap)) {
+      buf.write(static_string("skipped"));
+      buf.lf();
+      os::stdout.print(buf.head());
+      continue;
+    }
+
+    const u64 start = time::clock();
+    const CapSeedPair pair = search_cap(words, cap, workers);
+    const u64 end = time::clock();
+
+    var u64 attempts = 0;
+    for (uarch k = 0; k < workers.len; k += 1) {
+      attempts += workers.ptr[k].attempts;
+    }
+
+    if (pair.ok) {
+      buf.write(static_string("found seed "));
+      buf.dec(pair.seed);
+    } else {
+      buf.write(static_string("no seed"));
+    }
+    buf.write(static_string(" after "));
+    buf.dec(attempts);
+    buf.write(static_string(" attempts, "));
+    write_mcycles(&buf, end - start);
+    buf.lf();
+    os::stdout.print(buf.head());
+    os::stdout.flush();
+
+    if (pair.ok) {
+      mem::free(block);
+      return pair;
+    }
   }
 
-  return CapSeedPair{.seed = m.seed, .cap = cap, .ok = true};
+  mem::free(block);
+  return CapSeedPair{.seed = 0, .cap = 0, .ok = false};
+}
+
+// Returns true if some word occurs in text more than once. No seed
+// can separate equal words, thus search would be pointless
+fn bool has_duplicates(chunk<IndexedWord> words) noexcept {
+  var cont::HashMap<str, uarch> seen = cont::HashMap<str, uarch>(&mem::heap, words.len);
+  var bool dup = false;
+  for (uarch i = 0; i < words.len; i += 1) {
+    if (!seen.add(words.ptr[i].key, i)) {
+      dup = true;
+      break;
+    }
+  }
+  seen.free();
+  return dup;
+}
+
+// Writes integer in hexadecimal form with 0x prefix
+fn internal void write_hex(fmt::Buffer* buf, u64 x) noexcept {
+  must(buf->rem() >= 18);
+  buf->len += fmt::unsafe_hex_prefix(buf->tail(), x);
+}
+
+internal const uarch header_buf_size = 1 << 16;
+
+// Writes C++ header with fully populated entries of FlatMap<uarch> which
+// holds given words. Value of each entry is index of the word in input.
+// Including the header gives a ready to use map named <name>_map, which
+// needs no population or seed search at startup
+fn internal bool write_header(str path, str name, str source, chunk<IndexedWord> words, CapSeedPair pair) noexcept {
+  var cont::FlatMap<uarch> m = cont::FlatMap<uarch>(pair.cap, pair.cap - 1, pair.seed);
+  must(m.populate(words));
+
+  const os::OpenResult r = os::create(path);
+  if (r.is_err()) {
+    m.free();
+    return false;
+  }
+
+  var mc out_buf = mem::alloc(header_buf_size);
+  var bufio::Writer<os::Sink> w = bufio::Writer<os::Sink>(os::Sink(r.stream), out_buf);
+
+  // Buffer holds only fixed parts and numbers of each line, user supplied
+  // strings of any length go straight to writer
+  var u8 scratch[256] dirty;
+  var fmt::Buffer buf = fmt::Buffer(scratch, sizeof(scratch));
+
+  w.write_all(static_string("// Code generated by flatfit from "));
+  w.write_all(source);
+  w.write_all(static_string(". DO NOT EDIT\n//\n// Value of each entry is index of the word in source file\n\n"));
+
+  // constexpr places entries into read-only data of the binary
+  w.write_all(static_string("internal constexpr cont::FlatMap<uarch>::Entry "));
+  w.write_all(name);
+  buf.write(static_string("_entries["));
+  buf.dec(pair.cap);
+  buf.write(static_string("] = {\n"));
+  w.write_all(buf.head());
+
+  // allocated entries chunk may be longer than map capacity
+  for (uarch i = 0; i < pair.cap; i += 1) {
+    const cont::FlatMap<uarch>::Entry e = m.entries.ptr[i];
+
+    buf.reset();
+    if (!e.item.ok) {
+      buf.write(static_string("    {},\n"));
+      w.write_all(buf.head());
+      continue;
+    }
+
+    buf.write(static_string("    {.key = {"));
+    for (uarch j = 0; j < min(cast(uarch, e.len), cont::flat_map_key_size); j += 1) {
+      if (j != 0) {
+        buf.write(static_string(", "));
+      }
+      write_hex(&buf, e.key[j]);
+    }
+    buf.write(static_string("}, .hash = "));
+    write_hex(&buf, e.hash);
+    buf.write(static_string(", .len = "));
+    buf.dec(e.len);
+    buf.write(static_string(", .item = cont::FlatMap<uarch>::Item("));
+    buf.dec(e.item.value);
+    buf.write(static_string(")},\n"));
+    w.write_all(buf.head());
+  }
+
+  w.write_all(static_string("};\n\nvar internal cont::FlatMap<uarch> "));
+  w.write_all(name);
+  w.write_all(static_string("_map = cont::FlatMap<uarch>(\n    "));
+  w.write_all(name);
+  buf.reset();
+  buf.write(static_string("_entries, "));
+  buf.dec(pair.cap);
+  buf.write(static_string(", "));
+  buf.dec(pair.seed);
+  buf.write(static_string(", "));
+  buf.dec(m.len);
+  buf.write(static_string(", "));
+  buf.dec(m.min_key_len);
+  buf.write(static_string(", "));
+  buf.dec(m.max_key_len);
+  buf.write(static_string(");\n"));
+  w.write_all(buf.head());
+
+  const io::CloseResult cr = w.close();
+  mem::free(out_buf);
+  m.free();
+  return cr.is_ok();
 }
 
 } // namespace coven
 
 using namespace coven;
 
+// Usage: flatfit <words file> [<output header> [<name>]]
+//
+// When output header is specified, populated table is written there
+// as C++ source. Name is used as prefix for generated symbols and
+// defaults to "words"
 fn i32 main(i32 argc, u8** argv) noexcept {
   if (argc < 2) {
     return 1;
   }
   const cstr filename = cstr(argv[1]);
-  var os::FileReadResult rr = os::read_file(filename.as_str());
+  var os::FileReadResult rr = os::map_file(filename.as_str());
   if (rr.is_err()) {
     return 1;
   }
 
   var DynBuffer<IndexedWord> words = split_and_index_words(rr.data);
+  if (has_duplicates(words.head())) {
+    os::stdout.print(static_string("input contains duplicate words\n"));
+    os::stdout.flush();
+    return 1;
+  }
+
+  const u64 start = time::clock();
   const CapSeedPair pair = find_best_cap_and_seed(words.head());
+  const u64 end = time::clock();
 
   if (!pair.ok) {
-    stdout_write_all(
-        macro_static_str("failed to pick cap and seed for given input\n"));
+    os::stdout.print(static_string("failed to pick cap and seed for given input\n"));
+    os::stdout.flush();
     return 1;
   }
 
   var u8 scratch[256] dirty;
-  var bb buf = bb(scratch, sizeof(scratch));
-  buf.write(macro_static_str("len  = "));
-  buf.fmt_dec(words.len());
+  var fmt::Buffer buf = fmt::Buffer(scratch, sizeof(scratch));
+  buf.write(static_string("len  = "));
+  buf.dec(words.len());
+  buf.lf();
+  buf.write(static_string("cap  = "));
+  buf.dec(pair.cap);
   buf.lf();
-  buf.write(macro_static_str("cap  = "));
-  buf.fmt_dec(pair.cap);
+  buf.write(static_string("seed = "));
+  buf.dec(pair.seed);
   buf.lf();
-  buf.write(macro_static_str("seed = "));
-  buf.fmt_dec(pair.seed);
+  buf.write(static_string("time = "));
+  write_mcycles(&buf, end - start);
   buf.lf();
-  stdout_write_all(buf.head());
+  os::stdout.print(buf.head());
+  os::stdout.flush();
+
+  if (argc < 3) {
+    return 0;
+  }
+
+  var str name = static_string("words");
+  if (argc >= 4) {
+    name = cstr(argv[3]).as_str();
+  }
+  if (!write_header(cstr(argv[2]).as_str(), name, filename.as_str(), words.head(), pair)) {
+    os::stdout.print(static_string("failed to write header\n"));
+    os::stdout.flush();
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,136 @@
+using namespace coven;
+
+// Largest size of hashed input used in benchmark
+internal const uarch bench_max_size = 1 << 16;
+
+// Total number of bytes hashed for each size. Small sizes are
+// repeated many times to get stable measurements
+internal const uarch bench_total_bytes = 1 << 24;
+
+internal const uarch bench_min_rounds = 1 << 8;
+
+// Each measurement is repeated and the best result is reported, which
+// filters out interruptions by other processes
+internal const uarch bench_repeats = 5;
+
+// Seed used for all hashes, as in lookups of one table
+internal const u64 bench_seed = 0x2545F4914F6CDD1D;
+
+enum struct BenchHash : u8 {
+  Map,
+  Native,
+  Word,
+  Fnv,
+};
+
+internal const uarch bench_hash_count = 4;
+
+// Returns average number of cycles taken to hash n bytes. Hashes are
+// independent from each other, as in lookups of many keys in one table
+fn internal u64 measure(BenchHash kind, u8* p, uarch n) noexcept {
+  var uarch rounds = bench_total_bytes / n;
+  if (rounds < bench_min_rounds) {
+    rounds = bench_min_rounds;
+  }
+
+  var u64 h = 0;
+  const u64 start = time::clock();
+  for (uarch i = 0; i < rounds; i += 1) {
+    // prevents compiler from hoisting hash of the same input out of loop
+    asm volatile("" : "+r"(p));
+
+    switch (kind) {
+      case BenchHash::Map: {
+        h ^= hash::map::compute(bench_seed, mc(p, n));
+        break;
+      }
+      case BenchHash::Native: {
+        h ^= hash::native::compute(bench_seed, mc(p, n));
+        break;
+      }
+      case BenchHash::Word: {
+        h ^= hash::word::compute(bench_seed, p, n);
+        break;
+      }
+      case BenchHash::Fnv: {
+        var hash::fnv64a::Hasher hasher = hash::fnv64a::Hasher();
+        hasher.write(mc(p, n));
+        h ^= hasher.sum();
+        break;
+      }
+      default: {
+        unreachable();
+      }
+    }
+  }
+  const u64 end = time::clock();
+
+  // keeps result alive
+  asm volatile("" : : "r"(h));
+
+  return (end - start) / rounds;
+}
+
+fn internal u64 measure_best(BenchHash kind, u8* p, uarch n) noexcept {
+  var u64 best = measure(kind, p, n);
+  for (uarch i = 1; i < bench_repeats; i += 1) {
+    best = min(best, measure(kind, p, n));
+  }
+  return best;
+}
+
+// Width of table column in output
+internal const uarch bench_column_width = 10;
+
+// Write number right-aligned in table column
+fn internal void column(fmt::Buffer* buf, u64 x) noexcept {
+  var u8 digits[24] dirty;
+  const uarch n = fmt::dec(mc(digits, sizeof(digits)), x);
+  buf->write_repeat(bench_column_width - n, ' ');
+  buf->write(digits, n);
+}
+
+// Compares hash::map, hash::native, hash::word and fnv64a for input sizes
+// from 1 byte to 64 KiB. Sizes between powers of two are included, since
+// most keys in practice are short and their tails take separate paths.
+// Reported numbers are cycles per hash
+//
+// Debug build reports real timings too, but compares unoptimized code.
+// Use safe or fast build to compare hash functions
+fn i32 main() noexcept {
+  var mc data = mem::alloc(bench_max_size);
+  for (uarch i = 0; i < data.len; i += 1) {
+    data.ptr[i] = cast(u8, i * 131 + 7);
+  }
+
+  var u8 scratch[256] dirty;
+  var fmt::Buffer buf = fmt::Buffer(scratch, sizeof(scratch));
+
+  buf.write(static_string("     bytes       map    native      word    fnv64a"));
+  buf.lf();
+  os::stdout.print(buf.head());
+
+  for (uarch k = 1; k <= bench_max_size; k <<= 1) {
+    const uarch sizes[] = {k, k + (k >> 1)};
+    for (uarch j = 0; j < 2; j += 1) {
+      const uarch n = sizes[j];
+      if (n > bench_max_size || (j != 0 && n == k)) {
+        continue;
+      }
+
+      buf.reset();
+      column(&buf, n);
+      const BenchHash kinds[] = {BenchHash::Map, BenchHash::Native, BenchHash::Word, BenchHash::Fnv};
+      for (uarch i = 0; i < bench_hash_count; i += 1) {
+        column(&buf, measure_best(kinds[i], data.ptr, n));
+      }
+
+      buf.lf();
+      os::stdout.print(buf.head());
+      os::stdout.flush();
+    }
+  }
+
+  mem::free(data);
+  return 0;
+}
@@ -1,5 +1,14 @@
 namespace nord {
 
+// State which lexer carries over line boundary. Line is lexed
+// starting from state in which previous line ended
+enum struct LexState : u8 {
+  NORMAL = 0,
+
+  // inside block comment which is not closed yet
+  BLOCK_COMMENT,
+};
+
 // Lexer scans text in line and outputs tokens in sequential
 // manner
 struct Lexer {
@@ -7,7 +16,7 @@ struct Lexer {
   str text;
 
   // for detecting tokens with static literals
-  FlatMap* map;
+  const KeywordMap* map;
 
   // scan position
   u32 pos;
@@ -27,8 +36,22 @@ struct Lexer {
   // lexer reached end of input
   bool eof;
 
-  let Lexer(FlatMap* m, str s) noexcept
-      : text(s), map(m), pos(0), i(0), mark(0), c(0), next(0), eof(false) {
+  // state at current scan position, after all text is scanned
+  // holds state for the start of next line
+  LexState state;
+
+  let Lexer(const KeywordMap* m, str s) noexcept : Lexer(m, s, LexState::NORMAL) {}
+
+  let Lexer(const KeywordMap* m, str s, LexState st) noexcept
+      : text(s),
+        map(m),
+        pos(0),
+        i(0),
+        mark(0),
+        c(0),
+        next(0),
+        eof(false),
+        state(st) {
     //
     // prefill next and current bytes
     advance();
@@ -60,6 +83,10 @@ struct Lexer {
       return Token(Token::Kind::EOF);
     }
 
+    if (state == LexState::BLOCK_COMMENT) {
+      return block_comment();
+    }
+
     if (text::is_simple_whitespace(c)) {
       return whitespace();
     }
@@ -84,10 +111,14 @@ struct Lexer {
       return directive();
     }
 
-    if (c == '/' && next == '/') {
+    if (c == '/' && peek('/')) {
       return comment();
     }
 
+    if (c == '/' && peek('*')) {
+      return block_comment();
+    }
+
     return other();
   }
 
@@ -158,7 +189,7 @@ struct Lexer {
     }
 
     var str w = stop();
-    const FlatMap::Item item = map->get(w);
+    const KeywordMap::Item item = map->get(w);
     if (item.ok) {
       return Token(item.value, w);
     }
@@ -203,6 +234,30 @@ struct Lexer {
     return Token(Token::Kind::COMMENT, stop());
   }
 
+  // Scans block comment until its end or end of text. Comment which
+  // is not closed leaves lexer in BLOCK_COMMENT state
+  method Token block_comment() noexcept {
+    start();
+
+    if (state == LexState::NORMAL) {
+      advance();  // consume '/'
+      advance();  // consume '*'
+      state = LexState::BLOCK_COMMENT;
+    }
+
+    while (!eof) {
+      if (c == '*' && peek('/')) {
+        advance();  // consume '*'
+        advance();  // consume '/'
+        state = LexState::NORMAL;
+        break;
+      }
+      advance();
+    }
+
+    return Token(Token::Kind::COMMENT, stop());
+  }
+
   method Token string() noexcept {
     start();
 
@@ -243,6 +298,9 @@ struct Lexer {
     return Token(Token::Kind::PUNCTUATOR, stop());
   }
 
+  // true if byte after current one is present and equals x
+  method bool peek(u8 x) noexcept { return pos + 1 < text.len && next == x; }
+
   // place mark at current scan position
   method void start() noexcept { mark = pos; }
 
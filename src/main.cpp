@@ -85,30 +85,113 @@ struct Color {
   u8 green;
   u8 blue;
 
-  let Color() noexcept : red(0), green(0), blue(0) {}
-  let Color(u8 r, u8 g, u8 b) noexcept : red(r), green(g), blue(b) {}
+  let constexpr Color() noexcept : red(0), green(0), blue(0) {}
+  let constexpr Color(u8 r, u8 g, u8 b) noexcept : red(r), green(g), blue(b) {}
 };
 
 constexpr bool operator==(const Color& a, const Color& b) noexcept {
   return a.red == b.red && a.green == b.green && a.blue == b.blue;
 }
 
+// Longest sequence is "\x1b[38;2;255;255;255m"
+internal const usz color_sequence_max_size = 20;
+
+// Select graphic rendition parameter which changes text color
+internal const u8 sgr_text_color = 38;
+
+// Select graphic rendition parameter which changes background color
+internal const u8 sgr_background_color = 48;
+
+// Escape sequence which changes terminal text or background color
+// to a specific 24-bit color
+struct ColorSequence {
+  u8 buf[color_sequence_max_size];
+
+  u8 len;
+
+  let constexpr ColorSequence() noexcept : buf{}, len(0) {}
+
+  method constexpr void push(u8 x) noexcept {
+    buf[len] = x;
+    len = cast(u8, len + 1);
+  }
+
+  method constexpr void push_dec(u8 x) noexcept {
+    if (x >= 100) {
+      push(cast(u8, '0' + x / 100));
+    }
+    if (x >= 10) {
+      push(cast(u8, '0' + (x / 10) % 10));
+    }
+    push(cast(u8, '0' + x % 10));
+  }
+
+  method str as_str() const noexcept { return str(cast(u8*, buf), len); }
+};
+
+fn internal constexpr ColorSequence make_color_sequence(u8 sgr, Color color) noexcept {
+  var ColorSequence s = ColorSequence();
+
+  s.push(0x1B);
+  s.push('[');
+  s.push_dec(sgr);
+  s.push(';');
+  s.push('2');
+  s.push(';');
+  s.push_dec(color.red);
+  s.push(';');
+  s.push_dec(color.green);
+  s.push(';');
+  s.push_dec(color.blue);
+  s.push('m');
+
+  return s;
+}
+
 internal const usz terminal_sketch_buffer_size = 32;
 
+// Output is accumulated into frames. Each frame is submitted to terminal
+// with a single write and is wrapped into synchronized update mode, thus
+// terminal holds off drawing until the whole frame is received. Frame
+// begins implicitly with the first write into empty buffer and ends
+// with flush
 struct TerminalOutputBuffer {
   u8 sketch_buf[terminal_sketch_buffer_size];
 
   DynBytesBuffer db;
 
-  let TerminalOutputBuffer() noexcept {}
+  // Text and background colors which terminal will have after all
+  // buffered output is written. Color changes which do not alter
+  // this state are dropped. State is unknown if flag is not set
+  Color text_color;
+  Color background_color;
+  bool text_color_valid;
+  bool background_color_valid;
+
+  let TerminalOutputBuffer() noexcept
+      : text_color_valid(false), background_color_valid(false) {}
 
-  let TerminalOutputBuffer(usz initial_size) noexcept {
+  let TerminalOutputBuffer(usz initial_size) noexcept
+      : text_color_valid(false), background_color_valid(false) {
     db = DynBytesBuffer(initial_size);
   }
 
-  method void write(mc c) noexcept { db.write(c); }
+  method void write(mc c) noexcept {
+    begin_frame();
+    db.write(c);
+  }
+
+  method void write_repeat(usz n, u8 x) noexcept {
+    begin_frame();
+    db.write_repeat(n, x);
+  }
 
-  method void write_repeat(usz n, u8 x) noexcept { db.write_repeat(n, x); }
+  method void begin_frame() noexcept {
+    if (db.buf.len != 0) {
+      return;
+    }
+    db.write(macro_static_str("\x1b[?2026h"));
+  }
 
   method void change_cursor_position(u32 x, u32 y) noexcept {
     // prepare command string
@@ -129,53 +212,117 @@ struct TerminalOutputBuffer {
   }
 
   method void set_text_color(Color color) noexcept {
+    const ColorSequence seq = make_color_sequence(sgr_text_color, color);
+    set_text_color(color, seq.as_str());
+  }
+
+  // Same as set_text_color(color), but with already prepared
+  // escape sequence for that color
+  method void set_text_color(Color color, str seq) noexcept {
+    if (text_color_valid && text_color == color) {
+      return;
+    }
+    text_color = color;
+    text_color_valid = true;
+
+    write(seq);
+  }
+
+  method void set_background_color(Color color) noexcept {
+    const ColorSequence seq = make_color_sequence(sgr_background_color, color);
+    set_background_color(color, seq.as_str());
+  }
+
+  // Same as set_background_color(color), but with already prepared
+  // escape sequence for that color
+  method void set_background_color(Color color, str seq) noexcept {
+    if (background_color_valid && background_color == color) {
+      return;
+    }
+    background_color = color;
+    background_color_valid = true;
+
+    write(seq);
+  }
+
+  method void hide_cursor() noexcept { write(macro_static_str("\x1b[?25l")); }
+
+  method void show_cursor() noexcept { write(macro_static_str("\x1b[?25h")); }
+
+  // Restrict scrolling to rows [top, bottom) of the screen. Cursor
+  // is moved to top-left corner of the screen as a side effect
+  method void set_scroll_region(u32 top, u32 bottom) noexcept {
     var bb buf = bb(sketch_buf, terminal_sketch_buffer_size);
 
-    buf.write(macro_static_str("\x1b[38;2;"));
-    buf.fmt_dec(color.red);
-    buf.unsafe_write(';');
-    buf.fmt_dec(color.green);
+    buf.unsafe_write(macro_static_str("\x1b["));
+    buf.fmt_dec(top + 1);
     buf.unsafe_write(';');
-    buf.fmt_dec(color.blue);
-    buf.unsafe_write('m');
+    buf.fmt_dec(bottom);
+    buf.unsafe_write('r');
 
     write(buf.head());
   }
 
-  method void set_background_color(Color color) noexcept {
+  // Restore scrolling of entire screen. Cursor is moved to top-left
+  // corner of the screen as a side effect
+  method void reset_scroll_region() noexcept { write(macro_static_str("\x1b[r")); }
+
+  // Move contents of scroll region up by n rows, new blank rows
+  // appear at the bottom of region
+  method void scroll_up(u32 n) noexcept {
     var bb buf = bb(sketch_buf, terminal_sketch_buffer_size);
 
-    buf.write(macro_static_str("\x1b[48;2;"));
-    buf.fmt_dec(color.red);
-    buf.unsafe_write(';');
-    buf.fmt_dec(color.green);
-    buf.unsafe_write(';');
-    buf.fmt_dec(color.blue);
-    buf.unsafe_write('m');
+    buf.unsafe_write(macro_static_str("\x1b["));
+    buf.fmt_dec(n);
+    buf.unsafe_write('S');
 
     write(buf.head());
   }
 
-  method void hide_cursor() noexcept { write(macro_static_str("\x1b[?25l")); }
+  // Move contents of scroll region down by n rows, new blank rows
+  // appear at the top of region
+  method void scroll_down(u32 n) noexcept {
+    var bb buf = bb(sketch_buf, terminal_sketch_buffer_size);
 
-  method void show_cursor() noexcept { write(macro_static_str("\x1b[?25h")); }
+    buf.unsafe_write(macro_static_str("\x1b["));
+    buf.fmt_dec(n);
+    buf.unsafe_write('T');
+
+    write(buf.head());
+  }
 
   method void enter_alt_screen() noexcept {
     write(macro_static_str("\x1b[?1049h"));
   }
 
+  // Terminal restores attributes saved upon entering alternate screen,
+  // thus colors become unknown
   method void exit_alt_screen() noexcept {
     write(macro_static_str("\x1b[?1049l"));
+    text_color_valid = false;
+    background_color_valid = false;
   }
 
   // Begin new line in output
   method void nl() noexcept { write(macro_static_str("\r\n")); }
 
-  method void reset() noexcept { db.reset(); }
+  // Discard buffered output. Color changes may be discarded as well,
+  // thus colors become unknown
+  method void reset() noexcept {
+    db.reset();
+    text_color_valid = false;
+    background_color_valid = false;
+  }
 
+  // End current frame and submit it to terminal
   method void flush() noexcept {
+    if (db.buf.len == 0) {
+      return;
+    }
+
+    db.write(macro_static_str("\x1b[?2026l"));
     stdout_write_all(db.head());
-    reset();
+    db.reset();
   }
 };
 
@@ -233,10 +380,11 @@ struct Token {
   }
 };
 
-internal const Color default_color = Color(0xBB, 0xB2, 0xBF);
-internal const Color gutter_color = Color(0x64, 0x55, 0x4E);
+internal constexpr Color default_color = Color(0xBB, 0xB2, 0xBF);
+internal constexpr Color gutter_color = Color(0x64, 0x55, 0x4E);
+internal constexpr Color background_color = Color(0x20, 0x20, 0x20);
 
-internal const Color style[] = {
+internal constexpr Color style[] = {
     default_color,            // EMPTY
     default_color,            // EOF
     Color(0x56, 0xB6, 0xC2),  // DIRECTIVE
@@ -256,395 +404,1219 @@ internal const Color style[] = {
     default_color,            // NO_PRINT
 };
 
-internal const Token static_literals_table[] = {
-    Token(Token::Kind::DIRECTIVE, macro_static_str("#define")),
-    Token(Token::Kind::DIRECTIVE, macro_static_str("#include")),
-    Token(Token::Kind::DIRECTIVE, macro_static_str("#ifndef")),
-    Token(Token::Kind::DIRECTIVE, macro_static_str("#undef")),
-
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("var")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("const")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("struct")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("enum")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("fn")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("method")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("let")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("return")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("switch")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("if")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("else")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("while")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("namespace")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("typedef")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("case")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("default")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("continue")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("break")),
-    Token(Token::Kind::KEYWORD_GROUP_1, macro_static_str("do")),
-
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("internal")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("global")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("noexcept")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("dirty")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("sizeof")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("cast")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("constexpr")),
-    Token(Token::Kind::KEYWORD_GROUP_2, macro_static_str("inline")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("u8")),
-    Token(Token::Kind::BUILTIN, macro_static_str("i8")),
-    Token(Token::Kind::BUILTIN, macro_static_str("u16")),
-    Token(Token::Kind::BUILTIN, macro_static_str("i16")),
-    Token(Token::Kind::BUILTIN, macro_static_str("u32")),
-    Token(Token::Kind::BUILTIN, macro_static_str("i32")),
-    Token(Token::Kind::BUILTIN, macro_static_str("u64")),
-    Token(Token::Kind::BUILTIN, macro_static_str("i64")),
-    Token(Token::Kind::BUILTIN, macro_static_str("u128")),
-    Token(Token::Kind::BUILTIN, macro_static_str("i128")),
-    Token(Token::Kind::BUILTIN, macro_static_str("usz")),
-    Token(Token::Kind::BUILTIN, macro_static_str("isz")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("f32")),
-    Token(Token::Kind::BUILTIN, macro_static_str("f64")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("bool")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("mc")),
-    Token(Token::Kind::BUILTIN, macro_static_str("bb")),
-    Token(Token::Kind::BUILTIN, macro_static_str("error")),
-    Token(Token::Kind::BUILTIN, macro_static_str("str")),
-    Token(Token::Kind::BUILTIN, macro_static_str("cstr")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("nil")),
-    Token(Token::Kind::BUILTIN, macro_static_str("void")),
-    Token(Token::Kind::BUILTIN, macro_static_str("true")),
-    Token(Token::Kind::BUILTIN, macro_static_str("false")),
-
-    Token(Token::Kind::BUILTIN, macro_static_str("must")),
-    Token(Token::Kind::BUILTIN, macro_static_str("unreachable")),
-    Token(Token::Kind::BUILTIN, macro_static_str("panic")),
-    Token(Token::Kind::BUILTIN, macro_static_str("nop_use")),
-};
-
-#define FLAT_MAP_SEED 2664
+// Palette has one color for each token kind plus gutter color
+internal const usz palette_size = cast(usz, Token::Kind::NO_PRINT) + 2;
 
-// Hash table of static size with no collisions. This is achived
-// by handpicking starting seed for hash function
-struct FlatMap {
-  // Item stored in map. Returned when get method is used
-  struct Item {
-    // value that was placed in map by add method
-    Token::Kind value;
+// Palette index of gutter color. Other indices correspond to token kinds
+internal const u8 gutter_ink = cast(u8, palette_size - 1);
 
-    // true if item is actually stored in map, i.e.
-    // it is map item occupation flag
-    bool ok;
+// Colors used for drawing text together with prepared escape sequences
+// for each of them. Drawing a glyph in palette color costs a single copy
+// of prepared sequence (if color changes at all)
+struct Palette {
+  Color colors[palette_size];
 
-    // constructs empty item
-    let Item() noexcept : value(Token::Kind::EMPTY), ok(false) {}
+  // sequences which set text color to corresponding palette color
+  ColorSequence sequences[palette_size];
 
-    let Item(Token::Kind v) noexcept : value(v), ok(true) {}
-  };
+  Color background;
 
-  // Internal structure used for storing items in map
-  struct Entry {
-    // key hash of stored item
-    u64 hash;
+  ColorSequence background_sequence;
 
-    // key length of stored item
-    usz len;
+  // Palette with builtin colors, all sequences are prepared at
+  // compile time
+  let constexpr Palette() noexcept : colors{}, sequences{}, background(), background_sequence() {
+    for (usz i = 0; i < palette_size - 1; i += 1) {
+      set(cast(u8, i), style[i]);
+    }
+    set(gutter_ink, gutter_color);
+    set_background(background_color);
+  }
 
-    Item item;
-  };
+  method constexpr void set(u8 ink, Color color) noexcept {
+    colors[ink] = color;
+    sequences[ink] = make_color_sequence(sgr_text_color, color);
+  }
 
-  // continuous chunk of stored entries
-  chunk<Entry> entries;
+  method constexpr void set_background(Color color) noexcept {
+    background = color;
+    background_sequence = make_color_sequence(sgr_background_color, color);
+  }
 
-  u64 mask;
+  // Replace palette colors with colors from theme (in palette index
+  // order) and rebuild escape sequences for them. Theme may specify
+  // less colors than palette holds, remaining colors stay as is
+  method void load(chunk<Color> theme) noexcept {
+    must(theme.len <= palette_size);
 
-  u64 seed;
+    for (usz i = 0; i < theme.len; i += 1) {
+      set(cast(u8, i), theme.ptr[i]);
+    }
+  }
+};
 
-  // number of elements stored in map
-  usz len;
+internal constexpr Palette builtin_palette = Palette();
 
-  // minimal length of key stored in map
-  usz min_key_len;
+var global Palette palette = builtin_palette;
 
-  // maximum length of key stored in map
-  usz max_key_len;
+// Single character position on terminal screen
+struct ScreenCell {
+  u8 glyph;
 
-  let FlatMap() noexcept
-      : entries(chunk<Entry>()),
-        mask(0),
-        seed(0),
-        len(0),
-        min_key_len(0),
-        max_key_len(0) {}
+  // palette index of glyph color
+  u8 ink;
+};
 
-  let FlatMap(usz cap, u64 m, u64 s) noexcept
-      : entries(chunk<Entry>(nil, cap)),
-        mask(m),
-        seed(s),
-        len(0),
-        min_key_len(0),
-        max_key_len(0) {
-    //
-    init();
-  }
+constexpr bool operator==(const ScreenCell& a, const ScreenCell& b) noexcept {
+  return a.glyph == b.glyph && a.ink == b.ink;
+}
 
-  method void init() noexcept {
-    const usz cap = entries.len;
-    entries = mem::calloc<Entry>(cap);
-  }
+// Blank cells are compared without regard to text color
+internal const ScreenCell blank_cell = ScreenCell{.glyph = ' ', .ink = 0};
 
-  method bool is_nil() noexcept { return entries.is_nil(); }
+// Never drawn by editor, used to mark cells with unknown contents
+internal const ScreenCell unknown_cell = ScreenCell{.glyph = 0, .ink = 0};
 
-  method bool is_empty() noexcept { return len == 0; }
+// Number of unchanged cells between two changed ones which is cheaper
+// to write again than to jump over with cursor movement sequence
+internal const u32 screen_max_rewrite_gap = 4;
 
-  method void free() noexcept { mem::free(entries); }
+// Shadow copy of terminal screen contents
+//
+// Frames are composed in back grid. Front grid mirrors what terminal
+// actually displays. Rendering a frame compares the two grids and emits
+// output only for cells which differ, thus redrawing the whole viewport
+// costs next to nothing if most of it stays the same. Rows which were
+// touched since last render are marked as damaged, only such rows are
+// compared
+struct Screen {
+  // what terminal currently displays
+  chunk<ScreenCell> front;
+
+  // frame being composed
+  chunk<ScreenCell> back;
+
+  // damage flags for each row
+  chunk<bool> damage;
+
+  u32 rows;
+  u32 cols;
+
+  // terminal cursor position while rendering, cursor position is
+  // unknown if flag is not set
+  u32 cursor_x;
+  u32 cursor_y;
+  bool cursor_valid;
+
+  let Screen() noexcept {}
+
+  // Both grids start blank, which corresponds to freshly cleared screen
+  method void init(u32 r, u32 c) noexcept {
+    rows = r;
+    cols = c;
+
+    const usz n = cast(usz, rows) * cast(usz, cols);
+    front = mem::alloc<ScreenCell>(n);
+    back = mem::alloc<ScreenCell>(n);
+    damage = mem::alloc<bool>(rows);
+    for (usz i = 0; i < n; i += 1) {
+      front.ptr[i] = blank_cell;
+      back.ptr[i] = blank_cell;
+    }
+    for (u32 y = 0; y < rows; y += 1) {
+      damage.ptr[y] = false;
+    }
 
-  method u64 hash(mc key) noexcept { return hash::map::compute(seed, key); }
+    cursor_valid = false;
+  }
 
-  method usz determine_pos(u64 h) noexcept { return h & mask; }
+  // Must be called after terminal screen was cleared by other means
+  method void reset_front() noexcept {
+    const usz n = cast(usz, rows) * cast(usz, cols);
+    for (usz i = 0; i < n; i += 1) {
+      front.ptr[i] = blank_cell;
+    }
+    for (u32 y = 0; y < rows; y += 1) {
+      damage.ptr[y] = true;
+    }
+    cursor_valid = false;
+  }
 
-  // Returns true if item was successfully added to map.
-  // Returns false if corresponding cell was already
-  // occupied in map
-  method bool add(str key, Token::Kind value) noexcept {
-    const usz h = hash(key);
-    const usz pos = determine_pos(h);
+  // Forget what terminal displays, next render will output every cell.
+  // Must be called when palette colors change, because cells refer to
+  // colors by palette index
+  method void invalidate() noexcept {
+    const usz n = cast(usz, rows) * cast(usz, cols);
+    for (usz i = 0; i < n; i += 1) {
+      front.ptr[i] = unknown_cell;
+    }
+    for (u32 y = 0; y < rows; y += 1) {
+      damage.ptr[y] = true;
+    }
+    cursor_valid = false;
+  }
 
-    const Entry entry = entries.ptr[pos];
+  method ScreenCell* row(chunk<ScreenCell> grid, u32 y) noexcept {
+    return grid.ptr + cast(usz, y) * cast(usz, cols);
+  }
 
-    if (entry.item.ok) {
-      return false;
+  method void put(u32 x, u32 y, u8 glyph, u8 ink) noexcept {
+    if (x >= cols) {
+      return;
     }
 
-    entries.ptr[pos] = {
-        .hash = h,
-        .len = key.len,
-        .item = Item(value),
-    };
-
-    if (key.len > max_key_len) {
-      max_key_len = key.len;
+    if (glyph == ' ') {
+      row(back, y)[x] = blank_cell;
+    } else {
+      row(back, y)[x] = ScreenCell{.glyph = glyph, .ink = ink};
     }
+    damage.ptr[y] = true;
+  }
 
-    if (is_empty()) {
-      min_key_len = key.len;
-    } else if (key.len < min_key_len) {
-      min_key_len = key.len;
+  // Put string starting from specified position. Part of the string
+  // which does not fit into row is cut off
+  //
+  // Returns position right after the last put character
+  method u32 put(u32 x, u32 y, str s, u8 ink) noexcept {
+    for (usz i = 0; i < s.len; i += 1) {
+      put(x, y, s.ptr[i], ink);
+      x += 1;
     }
+    return x;
+  }
 
-    len += 1;
+  method u32 put_repeat(u32 x, u32 y, usz n, u8 glyph, u8 ink) noexcept {
+    for (usz i = 0; i < n; i += 1) {
+      put(x, y, glyph, ink);
+      x += 1;
+    }
+    return x;
+  }
 
-    return true;
+  // Fill row with blanks starting from specified position
+  method void clear_row(u32 x, u32 y) noexcept {
+    var ScreenCell* r = row(back, y);
+    for (; x < cols; x += 1) {
+      r[x] = blank_cell;
+    }
+    damage.ptr[y] = true;
   }
 
-  method Item get(str key) noexcept {
-    if ((key.len < min_key_len) || (key.len > max_key_len)) {
-      return Item();
+  // Move contents of rows [top, bottom) by d rows on terminal. Positive
+  // d moves contents up, negative moves it down. Rows which are exposed
+  // by the move become blank
+  //
+  // Only front grid is updated, back grid is expected to be composed
+  // again before next render
+  method void scroll(TerminalOutputBuffer* out, u32 top, u32 bottom, i32 d) noexcept {
+    must(top < bottom && bottom <= rows);
+
+    const u32 n = cast(u32, d < 0 ? -d : d);
+    if (n == 0 || n >= bottom - top) {
+      return;
     }
 
-    const usz h = hash(key);
-    const usz pos = determine_pos(h);
-    const Entry entry = entries.ptr[pos];
+    out->set_scroll_region(top, bottom);
+    if (d > 0) {
+      out->scroll_up(n);
+    } else {
+      out->scroll_down(n);
+    }
+    out->reset_scroll_region();
+    cursor_valid = false;
 
-    if (!entry.item.ok || entry.len != key.len || entry.hash != h) {
-      return Item();
+    const usz width = cols;
+    if (d > 0) {
+      for (u32 y = top; y < bottom - n; y += 1) {
+        copy_row(row(front, y), row(front, y + n), width);
+      }
+      for (u32 y = bottom - n; y < bottom; y += 1) {
+        blank_row(row(front, y), width);
+      }
+    } else {
+      for (u32 y = bottom - 1; y >= top + n; y -= 1) {
+        copy_row(row(front, y), row(front, y - n), width);
+      }
+      for (u32 y = top; y < top + n; y += 1) {
+        blank_row(row(front, y), width);
+      }
     }
 
-    return entry.item;
+    for (u32 y = top; y < bottom; y += 1) {
+      damage.ptr[y] = true;
+    }
   }
 
-  method void clear() noexcept {
-    entries.clear();
+  method void copy_row(ScreenCell* dst, ScreenCell* src, usz width) noexcept {
+    for (usz i = 0; i < width; i += 1) {
+      dst[i] = src[i];
+    }
+  }
 
-    len = 0;
-    min_key_len = 0;
-    max_key_len = 0;
+  method void blank_row(ScreenCell* r, usz width) noexcept {
+    for (usz i = 0; i < width; i += 1) {
+      r[i] = blank_cell;
+    }
   }
 
-  // print empty and occupied elements to buffer
-  // in illustrative way
-  method mc visualize(mc c) noexcept {
-    var bb buf = bb(c);
+  // Emit output which brings terminal screen to the state of back grid
+  method void render(TerminalOutputBuffer* out) noexcept {
+    for (u32 y = 0; y < rows; y += 1) {
+      if (!damage.ptr[y]) {
+        continue;
+      }
+      damage.ptr[y] = false;
 
-    const usz row_len = 64;
+      var ScreenCell* b = row(back, y);
+      var ScreenCell* f = row(front, y);
+      for (u32 x = 0; x < cols; x += 1) {
+        if (b[x] == f[x]) {
+          continue;
+        }
 
-    var Entry* p = entries.ptr;
-    for (usz i = 0; i < entries.len / row_len; i += 1) {
-      for (usz j = 0; j < row_len; j += 1) {
-        const Entry entry = p[j];
+        move_cursor(out, x, y);
+        emit(out, b[x]);
+        f[x] = b[x];
+      }
+    }
+  }
 
-        if (entry.item.ok) {
-          buf.write('X');
-        } else {
-          buf.write('_');
+  method void move_cursor(TerminalOutputBuffer* out, u32 x, u32 y) noexcept {
+    if (cursor_valid && cursor_y == y && cursor_x <= x) {
+      if (cursor_x == x) {
+        return;
+      }
+
+      if (x - cursor_x <= screen_max_rewrite_gap) {
+        // cells in gap are unchanged, thus writing them again does
+        // not alter the screen
+        const ScreenCell* r = row(back, y);
+        while (cursor_valid && cursor_x < x) {
+          emit(out, r[cursor_x]);
+        }
+        if (cursor_valid) {
+          return;
         }
       }
+    }
 
-      p += row_len;
-      buf.lf();
-      buf.lf();
+    out->change_cursor_position(x, y);
+    cursor_x = x;
+    cursor_y = y;
+    cursor_valid = true;
+  }
+
+  method void emit(TerminalOutputBuffer* out, ScreenCell c) noexcept {
+    // color of blank cell does not matter, skipping it keeps runs of
+    // same colored glyphs separated by spaces free of color changes
+    if (c.glyph != ' ') {
+      out->set_text_color(palette.colors[c.ink], palette.sequences[c.ink].as_str());
     }
 
-    return buf.head();
+    out->write(mc(&c.glyph, 1));
+    cursor_x += 1;
+
+    // Writing into the last column leaves cursor in pending wrap state.
+    // Multibyte characters occupy less columns than bytes. In both cases
+    // actual cursor position is not known
+    if (cursor_x >= cols || c.glyph >= 0x80) {
+      cursor_valid = false;
+    }
   }
 };
 
-var internal FlatMap token_kind_map = FlatMap(256, 0xFF, FLAT_MAP_SEED);
+// Words which are highlighted as directives, keywords and builtins
+internal constexpr cont::StaticPair<Token::Kind> token_literals[] = {
+    {"#define", Token::Kind::DIRECTIVE},
+    {"#include", Token::Kind::DIRECTIVE},
+    {"#ifndef", Token::Kind::DIRECTIVE},
+    {"#undef", Token::Kind::DIRECTIVE},
+
+    {"var", Token::Kind::KEYWORD_GROUP_1},
+    {"const", Token::Kind::KEYWORD_GROUP_1},
+    {"struct", Token::Kind::KEYWORD_GROUP_1},
+    {"enum", Token::Kind::KEYWORD_GROUP_1},
+    {"fn", Token::Kind::KEYWORD_GROUP_1},
+    {"method", Token::Kind::KEYWORD_GROUP_1},
+    {"let", Token::Kind::KEYWORD_GROUP_1},
+    {"return", Token::Kind::KEYWORD_GROUP_1},
+    {"switch", Token::Kind::KEYWORD_GROUP_1},
+    {"if", Token::Kind::KEYWORD_GROUP_1},
+    {"else", Token::Kind::KEYWORD_GROUP_1},
+    {"while", Token::Kind::KEYWORD_GROUP_1},
+    {"namespace", Token::Kind::KEYWORD_GROUP_1},
+    {"typedef", Token::Kind::KEYWORD_GROUP_1},
+    {"case", Token::Kind::KEYWORD_GROUP_1},
+    {"default", Token::Kind::KEYWORD_GROUP_1},
+    {"continue", Token::Kind::KEYWORD_GROUP_1},
+    {"break", Token::Kind::KEYWORD_GROUP_1},
+    {"do", Token::Kind::KEYWORD_GROUP_1},
+
+    {"internal", Token::Kind::KEYWORD_GROUP_2},
+    {"global", Token::Kind::KEYWORD_GROUP_2},
+    {"noexcept", Token::Kind::KEYWORD_GROUP_2},
+    {"dirty", Token::Kind::KEYWORD_GROUP_2},
+    {"sizeof", Token::Kind::KEYWORD_GROUP_2},
+    {"cast", Token::Kind::KEYWORD_GROUP_2},
+    {"constexpr", Token::Kind::KEYWORD_GROUP_2},
+    {"inline", Token::Kind::KEYWORD_GROUP_2},
+
+    {"u8", Token::Kind::BUILTIN},
+    {"i8", Token::Kind::BUILTIN},
+    {"u16", Token::Kind::BUILTIN},
+    {"i16", Token::Kind::BUILTIN},
+    {"u32", Token::Kind::BUILTIN},
+    {"i32", Token::Kind::BUILTIN},
+    {"u64", Token::Kind::BUILTIN},
+    {"i64", Token::Kind::BUILTIN},
+    {"u128", Token::Kind::BUILTIN},
+    {"i128", Token::Kind::BUILTIN},
+    {"usz", Token::Kind::BUILTIN},
+    {"isz", Token::Kind::BUILTIN},
+
+    {"f32", Token::Kind::BUILTIN},
+    {"f64", Token::Kind::BUILTIN},
+
+    {"bool", Token::Kind::BUILTIN},
+
+    {"mc", Token::Kind::BUILTIN},
+    {"bb", Token::Kind::BUILTIN},
+    {"error", Token::Kind::BUILTIN},
+    {"str", Token::Kind::BUILTIN},
+    {"cstr", Token::Kind::BUILTIN},
+
+    {"nil", Token::Kind::BUILTIN},
+    {"void", Token::Kind::BUILTIN},
+    {"true", Token::Kind::BUILTIN},
+    {"false", Token::Kind::BUILTIN},
+
+    {"must", Token::Kind::BUILTIN},
+    {"unreachable", Token::Kind::BUILTIN},
+    {"panic", Token::Kind::BUILTIN},
+    {"nop_use", Token::Kind::BUILTIN},
+};
 
-fn DynBuffer<Token> tokenize_line(FlatMap* map, mc line) noexcept {
-  if (line.is_nil()) {
-    return DynBuffer<Token>();
-  }
+// Perfect hash table of token literals. Seed and capacity are picked
+// at compile time, adding or removing a literal requires no other changes
+typedef cont::StaticMapOf<token_literals> KeywordMap;
+
+internal constexpr KeywordMap token_kind_map = KeywordMap(token_literals);
+
+// Token placement inside line text. Unlike Token it does not point into
+// line memory, thus remains valid when line text is assembled again
+struct LineToken {
+  // offset of token first byte from line start
+  u32 offset;
 
-  var DynBuffer<Token> buf = DynBuffer<Token>();
-  var nord::Lexer lx = nord::Lexer(map, line);
+  // number of bytes occupied by token
+  u32 len;
 
+  Token::Kind kind;
+};
+
+// Lex line text starting from offset base in state st and append produced
+// tokens to output, which must have append(LineToken) method
+//
+// Returns state in which lexer ends the line
+template <typename T>
+fn nord::LexState lex_line(const KeywordMap* map,
+                           str line,
+                           usz base,
+                           nord::LexState st,
+                           T* out) noexcept {
+  if (base >= line.len) {
+    return st;
+  }
+
+  var nord::Lexer lx = nord::Lexer(map, line.slice_from(base), st);
+  var u32 start = lx.pos;
   var Token tok = lx.lex();
   while (tok.kind != Token::Kind::EOF) {
-    buf.append(tok);
+    out->append(LineToken{
+        .offset = cast(u32, base + start),
+        .len = lx.pos - start,
+        .kind = tok.kind,
+    });
+
+    start = lx.pos;
     tok = lx.lex();
   }
 
-  return buf;
+  return lx.state;
 }
 
-struct TextLine {
-  DynBuffer<Token> tokens;
+// Lex line text in state st without producing tokens
+//
+// Returns state in which lexer ends the line
+fn nord::LexState lex_line_state(const KeywordMap* map,
+                                 str line,
+                                 nord::LexState st) noexcept {
+  if (line.len == 0) {
+    return st;
+  }
+
+  var nord::Lexer lx = nord::Lexer(map, line, st);
+  while (lx.lex().kind != Token::Kind::EOF) {
+  }
+  return lx.state;
+}
+
+// Maximum number of lines relexed after an edit while their carried
+// states keep changing. States of lines past this limit are dropped and
+// recomputed on demand
+internal const usz relex_lines_limit = 1 << 12;
+
+// Number of lines between consecutive checkpoints of lexer state
+internal const usz line_states_stride = 1 << 6;
+
+// Maximum number of consecutive lines which states are kept in window
+internal const usz line_states_window_size = 1 << 12;
+
+// Requested line which lies farther than this from known states gets
+// its state guessed instead of lexing all lines before it
+internal const usz line_states_guess_distance = 1 << 14;
+
+// Number of lines lexed before requested line when its state is guessed
+internal const usz line_states_guess_lines = 1 << 8;
+
+// Lexer state at the start of document line
+struct StateCheckpoint {
+  usz line;
+
+  nord::LexState state;
+};
+
+// Lexer states at the start of document lines. States are stored
+// sparsely in checkpoints which cover a prefix of document, states of
+// lines between checkpoints are recomputed from the nearest preceding
+// one and kept in a window of consecutive lines
+//
+// Request for a line far beyond known prefix does not lex all lines
+// before it. Its state is guessed by lexing a few preceding lines from
+// normal state and checked once known prefix reaches it during idle time
+struct LineStates {
+  // Sorted by line, first checkpoint is always placed at line 0.
+  // Neighbour checkpoints are at least stride lines apart unless lines
+  // between them were removed
+  DynBuffer<StateCheckpoint> checkpoints;
+
+  // Lines of checkpoints starting from this index are stored without
+  // pending shift. Edit moves shift start to itself and adds number of
+  // inserted or removed lines to shift, thus it only touches checkpoints
+  // between itself and previous edit
+  usz shift_start;
+
+  // wraps around for removed lines
+  usz shift;
+
+  // element i holds state at the start of line window_start + i
+  DynBuffer<nord::LexState> window;
 
-  DynBytesBuffer changed;
+  usz window_start;
 
-  // bytes that constitutes a line of text, not including
-  // trailing newline characters
-  mc data;
+  // window starts from guessed state and awaits check against checkpoints
+  bool guessed;
 
-  bool tokenized;
+  method void init() noexcept {
+    checkpoints.reset();
+    checkpoints.append(StateCheckpoint{.line = 0, .state = nord::LexState::NORMAL});
+    shift_start = 1;
+    shift = 0;
+
+    window.reset();
+    window_start = 0;
+    guessed = false;
+  }
+
+  // Returns state at the start of line k. States of preceding lines are
+  // computed starting from the nearest known one
+  method nord::LexState at(const KeywordMap* map,
+                           nord::PieceTable* doc,
+                           DynBytesBuffer* scratch,
+                           usz k) noexcept {
+    if (in_window(k)) {
+      return window.buf.ptr[k - window_start];
+    }
+
+    var usz c = find_checkpoint(k);
+    var usz j = checkpoint_line(c);
+    var nord::LexState st = checkpoints.buf.ptr[c].state;
+
+    const usz window_end = window_start + window.len();
+    if (window.len() != 0 && window_start <= k && window_end - 1 >= j) {
+      // window ends closer to requested line, continue it
+      j = window_end - 1;
+      st = window.buf.ptr[j - window_start];
+    } else {
+      reset_window(j, st, false);
+    }
+
+    if (c + 1 == checkpoints.len() && k - j > line_states_guess_distance) {
+      j = k - line_states_guess_lines;
+      st = nord::LexState::NORMAL;
+      reset_window(j, st, true);
+    }
 
-  let TextLine(str text) noexcept
-      : tokens(DynBuffer<Token>()), data(text), tokenized(false) {}
+    c = find_checkpoint(j);
+    while (j < k) {
+      st = lex_line_state(map, doc->line(j, scratch), st);
+      j += 1;
+
+      push_window(j, st);
+      if (!guessed) {
+        c = place_checkpoint(c, j, st);
+      }
+    }
+    return st;
+  }
 
-  method str content() noexcept {
-    if (!changed.is_nil()) {
-      return changed.head();
+  // Account for edit which changed text of line k and inserted (d > 0)
+  // or removed (d < 0) lines right after it
+  //
+  // Returns true if states of lines which were not touched by edit changed
+  method bool update(const KeywordMap* map,
+                     nord::PieceTable* doc,
+                     DynBytesBuffer* scratch,
+                     usz k,
+                     isz d) noexcept {
+    shift_window(k, d);
+
+    var usz last = k + cast(usz, max(d, cast(isz, 0)));
+    const bool moved = shift_checkpoints(k, d);
+    if (moved) {
+      // moved checkpoints carry states of removed lines
+      last = k + 1;
     }
-    return data;
+
+    const nord::LexState st = at(map, doc, scratch, k);
+    return propagate(map, doc, scratch, k, st, last) || moved;
   }
 
-  method void crop(usz n) noexcept {
-    tokenized = false;
-    if (!changed.is_nil()) {
-      changed.reset(n);
+  // Account for edit inside line k which did not change number of lines,
+  // with st being the state in which line k now ends
+  //
+  // Returns true if states of lines after line k changed
+  method bool update_end(const KeywordMap* map,
+                         nord::PieceTable* doc,
+                         DynBytesBuffer* scratch,
+                         usz k,
+                         nord::LexState st) noexcept {
+    if (!doc->has_line(k + 1)) {
+      return false;
+    }
+    return propagate(map, doc, scratch, k + 1, st, k);
+  }
+
+  // Compute states of n lines past known prefix, so that far jumps find
+  // them ready
+  //
+  // Returns true if guessed states in window turned out to be wrong
+  method bool extend(const KeywordMap* map,
+                     nord::PieceTable* doc,
+                     DynBytesBuffer* scratch,
+                     usz n) noexcept {
+    var usz c = checkpoints.len() - 1;
+    var usz j = checkpoint_line(c);
+    var nord::LexState st = checkpoints.buf.ptr[c].state;
+
+    if (guessed && window_start <= j) {
+      // window was moved behind known prefix by edits
+      drop_window();
+      return true;
+    }
+
+    const usz end = j + n;
+    while (j < end && doc->has_line(j + 1)) {
+      st = lex_line_state(map, doc->line(j, scratch), st);
+      j += 1;
+      c = place_checkpoint(c, j, st);
+
+      if (guessed && j == window_start) {
+        guessed = false;
+        if (window.buf.ptr[0] != st) {
+          drop_window();
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Store state st of line j and relex following lines until their states
+  // match the ones already known. States of lines up to last are stored
+  // unconditionally
+  //
+  // Returns true if states of lines after last changed
+  method bool propagate(const KeywordMap* map,
+                        nord::PieceTable* doc,
+                        DynBytesBuffer* scratch,
+                        usz j,
+                        nord::LexState st,
+                        usz last) noexcept {
+    var bool changed = false;
+    while (true) {
+      if (j > last) {
+        var nord::LexState old dirty;
+        if (known(j, &old)) {
+          if (old == st) {
+            break;
+          }
+        } else if (!covers(j)) {
+          // nothing is known beyond this line
+          break;
+        }
+        changed = true;
+      }
+
+      store(j, st);
+      if (j > last + relex_lines_limit || !doc->has_line(j + 1)) {
+        truncate(j);
+        break;
+      }
+
+      st = lex_line_state(map, doc->line(j, scratch), st);
+      j += 1;
+    }
+
+    return changed;
+  }
+
+  // Actual line of checkpoint i
+  method usz checkpoint_line(usz i) noexcept {
+    const usz line = checkpoints.buf.ptr[i].line;
+    if (i < shift_start) {
+      return line;
+    }
+    return line + shift;
+  }
+
+  method void set_checkpoint_line(usz i, usz line) noexcept {
+    if (i < shift_start) {
+      checkpoints.buf.ptr[i].line = line;
       return;
     }
-    data = data.slice_to(n);
+    checkpoints.buf.ptr[i].line = line - shift;
   }
 
-  method void append(str text) noexcept {
-    if (text.is_nil()) {
+  // Returns index of the last checkpoint placed at or before line k
+  method usz find_checkpoint(usz k) noexcept {
+    var usz lo = 0;
+    var usz hi = checkpoints.len();
+    while (hi - lo > 1) {
+      const usz mid = lo + ((hi - lo) >> 1);
+      if (checkpoint_line(mid) <= k) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // Place checkpoint at line j with state st, unless it lies too close
+  // to neighbour checkpoints. Argument c is index of the last checkpoint
+  // before line j
+  //
+  // Returns index of the last checkpoint at or before line j
+  method usz place_checkpoint(usz c, usz j, nord::LexState st) noexcept {
+    const usz next = c + 1;
+    if (next < checkpoints.len()) {
+      const usz line = checkpoint_line(next);
+      if (line <= j) {
+        return next;
+      }
+      if (line - j < line_states_stride) {
+        return c;
+      }
+    }
+    if (j - checkpoint_line(c) < line_states_stride) {
+      return c;
+    }
+
+    if (next < shift_start) {
+      shift_start += 1;
+    }
+    checkpoints.insert(next, StateCheckpoint{.line = 0, .state = st});
+    set_checkpoint_line(next, j);
+    return next;
+  }
+
+  // Move start of pending shift to checkpoint q
+  method void move_shift_start(usz q) noexcept {
+    while (shift_start < q) {
+      checkpoints.buf.ptr[shift_start].line += shift;
+      shift_start += 1;
+    }
+    while (shift_start > q) {
+      shift_start -= 1;
+      checkpoints.buf.ptr[shift_start].line -= shift;
+    }
+  }
+
+  // Shift lines of checkpoints after line k by d. Checkpoints of removed
+  // lines move to the line after them
+  //
+  // Returns true if any checkpoint was moved that way
+  method bool shift_checkpoints(usz k, isz d) noexcept {
+    const usz q = find_checkpoint(k) + 1;
+    if (q >= checkpoints.len()) {
+      return false;
+    }
+
+    move_shift_start(q);
+
+    var bool moved = false;
+    if (d < 0) {
+      const usz removed_end = k + cast(usz, -d);
+      for (usz i = q; i < checkpoints.len() && checkpoint_line(i) <= removed_end; i += 1) {
+        set_checkpoint_line(i, removed_end + 1);
+        moved = true;
+      }
+    }
+    shift += cast(usz, d);
+    return moved;
+  }
+
+  method bool in_window(usz k) noexcept {
+    return k >= window_start && k - window_start < window.len();
+  }
+
+  method void reset_window(usz j, nord::LexState st, bool g) noexcept {
+    window.reset();
+    window.append(st);
+    window_start = j;
+    guessed = g;
+  }
+
+  method void drop_window() noexcept {
+    window.reset();
+    guessed = false;
+  }
+
+  // Append state st of line j right after window
+  method void push_window(usz j, nord::LexState st) noexcept {
+    if (window.len() >= line_states_window_size) {
+      // window restarts from line j, lines before it are recomputed
+      // from checkpoints
+      window.reset();
+      window_start = j;
+    }
+    window.append(st);
+  }
+
+  method void shift_window(usz k, isz d) noexcept {
+    if (window.len() == 0) {
       return;
     }
-    tokenized = false;
-    if (changed.is_nil()) {
-      changed = DynBytesBuffer(data);
+
+    if (k + 1 < window_start) {
+      if (d < 0 && k + cast(usz, -d) >= window_start) {
+        drop_window();
+        return;
+      }
+      window_start += cast(usz, d);
+      return;
+    }
+
+    const usz i = k + 1 - window_start;
+    if (i > window.len()) {
+      return;
+    }
+    for (isz n = 0; n < d; n += 1) {
+      // actual states are stored by propagation
+      window.insert(i, nord::LexState::NORMAL);
+    }
+    for (isz n = 0; n > d && i < window.len(); n -= 1) {
+      window.remove(i);
     }
-    changed.write(text);
   }
 
-  method void insert(usz i, u8 x) noexcept {
-    if (changed.is_nil()) {
-      changed = DynBytesBuffer(data);
+  // Reports whether state of line j is stored, places it into st
+  method bool known(usz j, nord::LexState* st) noexcept {
+    if (in_window(j)) {
+      *st = window.buf.ptr[j - window_start];
+      return true;
     }
-    changed.insert(i, x);
-    tokenize(&token_kind_map);
+
+    const usz c = find_checkpoint(j);
+    if (checkpoint_line(c) != j) {
+      return false;
+    }
+    *st = checkpoints.buf.ptr[c].state;
+    return true;
+  }
+
+  // Reports whether states are stored for line j or lines after it
+  method bool covers(usz j) noexcept {
+    if (checkpoint_line(checkpoints.len() - 1) >= j) {
+      return true;
+    }
+    return window.len() != 0 && window_start + window.len() > j;
   }
 
-  method void remove(usz i) noexcept {
-    if (changed.is_nil()) {
-      changed = DynBytesBuffer(data);
+  method void store(usz j, nord::LexState st) noexcept {
+    if (in_window(j)) {
+      window.buf.ptr[j - window_start] = st;
+    }
+
+    var usz c = find_checkpoint(j);
+    while (checkpoint_line(c) == j) {
+      checkpoints.buf.ptr[c].state = st;
+      if (c == 0) {
+        break;
+      }
+      c -= 1;
     }
-    changed.remove(i);
-    tokenize(&token_kind_map);
   }
 
-  method void tokenize(FlatMap* map) noexcept {
-    tokenized = true;
+  // Drop states of lines after line j
+  method void truncate(usz j) noexcept {
+    const usz n = find_checkpoint(j) + 1;
+    checkpoints.buf.len = n;
+    if (shift_start > n) {
+      shift_start = n;
+    }
+
+    if (window.len() == 0) {
+      return;
+    }
+    if (window_start > j) {
+      drop_window();
+      return;
+    }
+    if (window.len() > j - window_start + 1) {
+      window.buf.len = j - window_start + 1;
+    }
+  }
+};
+
+// Tokens of a line which are kept between edits, so that an edit
+// relexes only the part of line it can affect
+struct LineTokens {
+  DynBuffer<LineToken> tokens;
+
+  // scratch for tokens which replace relexed part of line
+  DynBuffer<LineToken> tail;
+
+  // index of line to which tokens belong
+  usz line;
+
+  // state at the start and at the end of line
+  nord::LexState start;
+  nord::LexState end;
+
+  bool ok;
+
+  method bool has(usz k, nord::LexState st) noexcept {
+    return ok && line == k && start == st;
+  }
+
+  method void invalidate() noexcept { ok = false; }
+
+  method void lex(const KeywordMap* map, str text, usz k, nord::LexState st) noexcept {
     tokens.reset();
+    end = lex_line(map, text, 0, st, &tokens);
+    line = k;
+    start = st;
+    ok = true;
+  }
+
+  // Update tokens of line k after its bytes at [pos, pos + removed) were
+  // replaced by inserted number of bytes. Lexing restarts from token
+  // boundary before edit and stops as soon as lexer reaches boundary of
+  // a token which was present before edit
+  method void relex(const KeywordMap* map,
+                    str text,
+                    usz k,
+                    nord::LexState st,
+                    usz pos,
+                    usz removed,
+                    usz inserted) noexcept {
+    if (!has(k, st)) {
+      lex(map, text, k, st);
+      return;
+    }
+
+    // find first token which reaches edit position, token before it
+    // is relexed too since edit may merge into it
+    const usz n = tokens.buf.len;
+    var usz i = 0;
+    while (i < n && tokens.buf.ptr[i].offset + tokens.buf.ptr[i].len < pos) {
+      i += 1;
+    }
+    if (i != 0) {
+      i -= 1;
+    }
 
-    var str s = content();
-    if (s.is_nil()) {
+    var usz base = 0;
+    if (i < n) {
+      base = tokens.buf.ptr[i].offset;
+    }
+
+    // token boundary inside line is always in normal state
+    var nord::LexState s = nord::LexState::NORMAL;
+    if (i == 0) {
+      s = st;
+    }
+
+    tail.reset();
+    if (base >= text.len) {
+      tokens.buf.len = i;
+      end = s;
       return;
     }
 
-    var nord::Lexer lx = nord::Lexer(map, s);
-    var Token tok = lx.lex();
-    while (tok.kind != Token::Kind::EOF) {
-      tokens.append(tok);
-      tok = lx.lex();
+    var nord::Lexer lx = nord::Lexer(map, text.slice_from(base), s);
+    var usz j = i;
+    while (true) {
+      const usz offset = base + lx.pos;
+      if (offset >= pos + inserted && lx.state == nord::LexState::NORMAL) {
+        // same position in line text before edit
+        const usz old = offset - inserted + removed;
+        while (j < n && tokens.buf.ptr[j].offset < old) {
+          j += 1;
+        }
+
+        if (old != 0 && j < n && tokens.buf.ptr[j].offset == old) {
+          // lexer is in the same state at the same text as before edit,
+          // thus remaining tokens will not change apart from offsets
+          for (; j < n; j += 1) {
+            var LineToken t = tokens.buf.ptr[j];
+            t.offset = cast(u32, t.offset + inserted - removed);
+            tail.append(t);
+          }
+          break;
+        }
+      }
+
+      const u32 a = lx.pos;
+      const Token tok = lx.lex();
+      if (tok.kind == Token::Kind::EOF) {
+        end = lx.state;
+        break;
+      }
+
+      tail.append(LineToken{
+          .offset = cast(u32, base + a),
+          .len = lx.pos - a,
+          .kind = tok.kind,
+      });
     }
-  }
 
-  method void free() noexcept {
-    tokens.free();
-    changed.free();
+    tokens.buf.len = i;
+    for (usz t = 0; t < tail.buf.len; t += 1) {
+      tokens.append(tail.buf.ptr[t]);
+    }
   }
 };
 
-fn internal DynBuffer<TextLine> split_lines(mc text) noexcept {
-  const usz avg_bytes_per_line = 25;  // empirical constant
+// Number of pages above and below viewport for which tokens are kept
+// in cache and lexed ahead of time
+internal const u32 token_cache_pages = 2;
 
-  var DynBuffer<TextLine> buf =
-      DynBuffer<TextLine>(text.len / avg_bytes_per_line);
+// Number of tokens in a single block of token storage
+internal const usz token_block_size = 32;
 
-  // start index of current line in text chunk
-  var usz start = 0;
+// Max length of stored token. Longer tokens are stored as several
+// consecutive tokens of the same kind
+internal const u32 token_max_len = 0xFFFF;
 
-  // end index of current line in text chunk
-  var usz end = 0;
+// Fixed size block of compactly stored tokens. Token fields are placed
+// in separate arrays, walking over tokens touches only a few cache lines
+struct TokenBlock {
+  // offset of token first byte from line start
+  u32 offset[token_block_size];
 
-  // line append index
-  var usz j = 0;
+  // number of bytes occupied by token
+  u16 len[token_block_size];
 
-  // text scan index
-  var usz i = 0;
-  while (i < text.len) {
-    var u8 c = text.ptr[i];
+  Token::Kind kind[token_block_size];
+
+  // next block of the same list
+  TokenBlock* next;
+};
 
-    if (c != '\r' && c != '\n') {
-      end += 1;
+// Tokens of a line stored in chain of blocks. All blocks except
+// the last one are full
+struct TokenList {
+  TokenBlock* head;
+  TokenBlock* tail;
+
+  // number of stored tokens
+  u32 len;
+};
+
+// Token blocks shared by all token lists. Blocks of released lists
+// go back to pool and are reused by other lists
+struct TokenStore {
+  mem::Pool<TokenBlock> blocks;
+
+  method TokenBlock* take() noexcept {
+    var TokenBlock* b = blocks.alloc();
+    b->next = nil;
+    return b;
+  }
+
+  // Return blocks of the list to storage and make the list empty
+  method void release(TokenList* list) noexcept {
+    var TokenBlock* b = list->head;
+    while (b != nil) {
+      var TokenBlock* next = b->next;
+      blocks.free(b);
+      b = next;
     }
 
-    if (c == '\n') {
-      const mc line = text.slice(start, end);
-      const TextLine text_line = TextLine(line);
+    list->head = nil;
+    list->tail = nil;
+    list->len = 0;
+  }
 
-      buf.append(text_line);
+  method void append(TokenList* list, LineToken t) noexcept {
+    var u32 offset = t.offset;
+    var u32 n = t.len;
+    do {
+      const u32 len = min(n, token_max_len);
 
-      j += 1;
+      const usz i = list->len % token_block_size;
+      if (i == 0) {
+        var TokenBlock* b = take();
+        if (list->tail == nil) {
+          list->head = b;
+        } else {
+          list->tail->next = b;
+        }
+        list->tail = b;
+      }
+
+      list->tail->offset[i] = offset;
+      list->tail->len[i] = cast(u16, len);
+      list->tail->kind[i] = t.kind;
+      list->len += 1;
+
+      offset += len;
+      n -= len;
+    } while (n != 0);
+  }
+};
 
-      start = i + 1;
-      end = start;
+// Appends lexed tokens to the list held in token storage
+struct TokenListWriter {
+  TokenStore* store;
+  TokenList* list;
+
+  method void append(LineToken t) noexcept { store->append(list, t); }
+};
+
+// Bounded cache of line tokens. Lines which were not used for the
+// longest time are evicted when cache runs out of slots, thus memory
+// occupied by tokens does not depend on document size
+struct TokenCache {
+  struct Slot {
+    TokenList tokens;
+
+    // index of cached line
+    usz line;
+
+    // tick of last use, slots with zero tick are empty
+    u64 tick;
+
+    // state at the start of cached line
+    nord::LexState start;
+  };
+
+  chunk<Slot> slots;
+
+  // blocks for tokens of all slots
+  TokenStore store;
+
+  // incremented on each cache use
+  u64 tick;
+
+  let TokenCache() noexcept {}
+
+  method void init(usz n) noexcept {
+    slots = mem::alloc<Slot>(n);
+    for (usz i = 0; i < slots.len; i += 1) {
+      slots.ptr[i].tokens = TokenList{.head = nil, .tail = nil, .len = 0};
+      slots.ptr[i].line = 0;
+      slots.ptr[i].tick = 0;
     }
+    store.blocks = mem::Pool<TokenBlock>();
+    tick = 0;
+  }
+
+  // Returns tokens of line k lexed from state st or nil if they
+  // are not present in cache
+  method TokenList* find(usz k, nord::LexState st) noexcept {
+    for (usz i = 0; i < slots.len; i += 1) {
+      var Slot* slot = slots.ptr + i;
+      if (slot->tick != 0 && slot->line == k) {
+        if (slot->start != st) {
+          // state carried from previous lines has changed
+          slot->tick = 0;
+          return nil;
+        }
 
-    i += 1;
+        tick += 1;
+        slot->tick = tick;
+        return &slot->tokens;
+      }
+    }
+    return nil;
   }
 
-  if (start == end) {
-    // no need to save last line
-    return buf;
+  // Lex line k with text s from state st into least recently used slot
+  method TokenList* put(const KeywordMap* map, usz k, nord::LexState st, str s) noexcept {
+    var Slot* slot = slots.ptr;
+    for (usz i = 1; i < slots.len && slot->tick != 0; i += 1) {
+      if (slots.ptr[i].tick < slot->tick) {
+        slot = slots.ptr + i;
+      }
+    }
+
+    tick += 1;
+    slot->tick = tick;
+    slot->line = k;
+    slot->start = st;
+    store.release(&slot->tokens);
+    var TokenListWriter w = TokenListWriter{.store = &store, .list = &slot->tokens};
+    lex_line(map, s, 0, st, &w);
+    return &slot->tokens;
   }
 
-  // save last line
-  const mc line = text.slice(start, end);
-  const TextLine text_line = TextLine(line);
-  buf.append(text_line);
+  method void invalidate(usz k) noexcept {
+    for (usz i = 0; i < slots.len; i += 1) {
+      if (slots.ptr[i].line == k) {
+        slots.ptr[i].tick = 0;
+      }
+    }
+  }
 
-  j += 1;
+  // Account for edit which changed line k and inserted (d > 0) or
+  // removed (d < 0) lines right after it
+  method void shift(usz k, isz d) noexcept {
+    // last line which was changed or removed by edit
+    const usz last = k + cast(usz, max(-d, cast(isz, 0)));
+    for (usz i = 0; i < slots.len; i += 1) {
+      var Slot* slot = slots.ptr + i;
+      if (slot->line < k) {
+        continue;
+      }
 
-  return buf;
-}
+      if (slot->line <= last) {
+        slot->tick = 0;
+      } else {
+        slot->line = cast(usz, cast(isz, slot->line) + d);
+      }
+    }
+  }
+};
+
+// Number of document bytes indexed each time editor is idle
+internal const usz idle_index_size = 1 << 20;
+
+// Number of lines which lexer states are computed each time editor is idle
+internal const usz idle_states_lines = 1 << 12;
 
 struct Editor {
   // type of input sequence
@@ -679,7 +1651,23 @@ struct Editor {
 
   TerminalOutputBuffer term_buf;
 
-  DynBuffer<TextLine> lines;
+  // shadow copy of terminal screen, all drawing goes through it
+  Screen screen;
+
+  // text of a file being edited
+  nord::PieceTable doc;
+
+  // scratch buffer for assembling lines which span several pieces
+  DynBytesBuffer line_buf;
+
+  // tokens of lines in and around viewport
+  TokenCache tokens_cache;
+
+  // lexer states carried between document lines
+  LineStates line_states;
+
+  // tokens of line under cursor, edits update them incrementally
+  LineTokens cursor_tokens;
 
   // path to a file being edited
   str filename;
@@ -710,24 +1698,25 @@ struct Editor {
   // value at current viewport position
   u32 gutter_width;
 
-  Color text_color;
-
   bool full_viewport_upd_flag;
 
   let Editor() noexcept {}
 
   method void init() noexcept {
+    // empty document still needs sentinel node of piece table
+    doc.init(str());
+    line_states.init();
+    cursor_tokens.invalidate();
     init_terminal();
 
-    term_buf.hide_cursor();
     draw_text();
-    term_buf.show_cursor();
-    update_cursor_position();
-    term_buf.flush();
+    present();
   }
 
   method void init(str name) noexcept {
-    var fs::FileReadResult result = fs::read_file(name);
+    // file contents are mapped instead of being copied into heap, edits
+    // never touch this memory since they go into piece table add buffer
+    var coven::os::FileReadResult result = coven::os::map_file(name);
     if (result.is_err()) {
       // TODO: display error message
       return;
@@ -736,26 +1725,17 @@ struct Editor {
     filename = name;
     var mc text = result.data;
 
-    lines = split_lines(text);
+    doc.init(text);
+    line_states.init();
+    cursor_tokens.invalidate();
 
     init_terminal();
 
     term_buf.hide_cursor();
-    term_buf.set_background_color(Color(0x20, 0x20, 0x20));
-    term_buf.flush();
+    term_buf.set_background_color(palette.background, palette.background_sequence.as_str());
     clear_window();
     draw_text();
-    update_cursor_position();
-    term_buf.show_cursor();
-    term_buf.flush();
-  }
-
-  method void change_text_color(Color color) noexcept {
-    if (text_color == color) {
-      return;
-    }
-
-    term_buf.set_text_color(color);
+    present();
   }
 
   method void init_terminal() noexcept {
@@ -774,7 +1754,6 @@ struct Editor {
 
     term_buf = TerminalOutputBuffer(COMMAND_BUFFER_INITIAL_SIZE);
     term_buf.enter_alt_screen();
-    term_buf.flush();
 
     struct winsize ws = get_viewport_size();
     rows_num = cast(u32, ws.ws_row);
@@ -782,62 +1761,95 @@ struct Editor {
     vrows = rows_num - 1;
     vcols = cols_num - 6;
 
+    screen.init(rows_num, cols_num);
+    tokens_cache.init(cast(usz, vrows) * (2 * token_cache_pages + 1));
+
     viewport_page_stride = (2 * rows_num) / 3;
   }
 
   method void save_file() noexcept {
     lg.info(macro_static_str("saving file"));
-    const fs::OpenResult r = fs::create(filename);
+
+    // Writes go to the file which symlink points to, otherwise symlink
+    // would be replaced by a regular file
+    var u8 path_buf[1 << 12] dirty;
+    const str path = fs::resolve(filename, mc(path_buf, sizeof(path_buf)));
+    if (path.is_nil()) {
+      lg.error(macro_static_str("failed to resolve file path"));
+      return;
+    }
+
+    // Original text of document is mapped from the file being saved, thus
+    // the file cannot be truncated until all pieces are written. Document
+    // goes into temporary file next to it, which then replaces the file
+    const str suffix = macro_static_str(".nord-save");
+    var u8 tmp_buf[1 << 12] dirty;
+    if (path.len + suffix.len > sizeof(tmp_buf)) {
+      lg.error(macro_static_str("file path is too long"));
+      return;
+    }
+    for (usz i = 0; i < path.len; i += 1) {
+      tmp_buf[i] = path.ptr[i];
+    }
+    for (usz i = 0; i < suffix.len; i += 1) {
+      tmp_buf[path.len + i] = suffix.ptr[i];
+    }
+    const str tmp_name = str(tmp_buf, path.len + suffix.len);
+
+    const fs::OpenResult r = fs::create(tmp_name);
     if (r.is_err()) {
       lg.error(macro_static_str("failed to create file"));
       return;
     }
 
+    // replacement keeps permissions of the original file
+    if (!fs::copy_mode(path, r.fd)) {
+      lg.error(macro_static_str("failed to copy file mode"));
+      fs::close(r.fd);
+      fs::remove(tmp_name);
+      return;
+    }
+
     var u8 write_buf[1 << 13] dirty;
     var fs::BufFileWriter w =
         fs::BufFileWriter(r.fd, mc(write_buf, sizeof(write_buf)));
 
-    for (usz i = 0; i < lines.len(); i += 1) {
-      var fs::WriteResult wr = w.write(lines.buf.ptr[i].content());
-      if (wr.is_err()) {
-        return;
-      }
+    if (!doc.write_to(w) || w.flush().is_err()) {
+      lg.error(macro_static_str("failed to write file"));
+      w.close();
+      fs::remove(tmp_name);
+      return;
+    }
 
-      wr = w.lf();
-      if (wr.is_err()) {
-        return;
-      }
+    // original file must not be replaced until new contents reach the disk
+    if (!fs::sync_and_close(r.fd)) {
+      lg.error(macro_static_str("failed to write file"));
+      fs::remove(tmp_name);
+      return;
     }
 
-    w.close();  // TODO: check this error
+    if (!fs::rename(tmp_name, path)) {
+      lg.error(macro_static_str("failed to replace file"));
+      fs::remove(tmp_name);
+      return;
+    }
     lg.info(macro_static_str("file saved"));
   }
 
+  // Compose entire viewport on screen
   method void draw_text() noexcept {
     update_gutter_width();
 
-    // y coordinate inside viewport
-    var u32 y = 0;
-
-    const u32 max_text_width = cols_num - cast(u32, gutter_width);
-
-    // line index which is drawn at current y coordinate
-    var usz j = vy;
-    while (y < vrows - 1 && j < lines.len()) {
-      draw_gutter(cast(u32, j + 1));
-      // change_text_color(default_color);
-      draw_line(j, max_text_width);
-      term_buf.nl();
-
-      y += 1;
-      j += 1;
-    }
+    for (u32 y = 0; y < vrows; y += 1) {
+      // line index which is drawn at current y coordinate
+      const usz j = vy + y;
+      if (!doc.has_line(j)) {
+        screen.clear_row(0, y);
+        continue;
+      }
 
-    // draw last line without newline at the end
-    if (y == vrows - 1 && j < lines.len()) {
-      draw_gutter(cast(u32, j + 1));
-      // term_buf.set_text_color(default_color);
-      draw_line(j, max_text_width);
+      draw_gutter(y, cast(u32, j + 1));
+      draw_line(y, j);
     }
   }
 
@@ -845,7 +1857,7 @@ struct Editor {
     var u8 gutter_buf[16] dirty;
     var bb buf = bb(gutter_buf, sizeof(gutter_buf));
 
-    const u32 max_line_number = min(vy + rows_num, cast(u32, lines.len()));
+    const u32 max_line_number = cast(u32, doc.clamp_line_count(vy + rows_num));
     const usz line_number_width = buf.unsafe_fmt_dec(max_line_number);
 
     // gutter has format "xxxx  " with number aligned to right
@@ -854,70 +1866,181 @@ struct Editor {
     vcols = cols_num - gutter_width;
   }
 
-  method void draw_gutter(u32 line_number) noexcept {
-    change_text_color(gutter_color);
-
+  method void draw_gutter(u32 y, u32 line_number) noexcept {
     var u8 gutter_buf[16] dirty;
     var bb buf = bb(gutter_buf, sizeof(gutter_buf));
 
     var usz n = buf.fmt_dec(line_number);
     buf.write_repeat(gutter_width - n, ' ');
-    term_buf.write(buf.head());
+    screen.put(0, y, buf.head(), gutter_ink);
   }
 
-  method void draw_line(usz k, u32 max_width) noexcept {
-    nop_use(max_width);
+  // Compose line k at screen row y after gutter
+  method void draw_line(u32 y, usz k) noexcept {
+    const nord::LexState st = line_start_state(k);
+    const str s = doc.line(k, &line_buf);
+
+    var u32 x = gutter_width;
+    if (k == vy + ty) {
+      if (!cursor_tokens.has(k, st)) {
+        cursor_tokens.lex(&token_kind_map, s, k, st);
+      }
+
+      const DynBuffer<LineToken>* tokens = &cursor_tokens.tokens;
+      for (usz i = 0; i < tokens->buf.len && x < cols_num; i += 1) {
+        const LineToken tok = tokens->buf.ptr[i];
+        x = draw_token(x, y, tok.kind, s.slice(tok.offset, tok.offset + tok.len));
+      }
+    } else {
+      const TokenList* tokens = line_tokens(k, st, s);
+
+      var usz n = tokens->len;
+      for (const TokenBlock* b = tokens->head; b != nil && x < cols_num; b = b->next) {
+        const usz m = min(n, token_block_size);
+        for (usz i = 0; i < m && x < cols_num; i += 1) {
+          const usz offset = b->offset[i];
+          x = draw_token(x, y, b->kind[i], s.slice(offset, offset + b->len[i]));
+        }
+        n -= m;
+      }
+    }
+    screen.clear_row(x, y);
+  }
+
+  // Put token with text t at screen position (x, y)
+  //
+  // Returns screen column after the token
+  method u32 draw_token(u32 x, u32 y, Token::Kind kind, str t) noexcept {
+    switch (kind) {
+      case Token::Kind::SPACE: {
+        return screen.put_repeat(x, y, t.len, ' ', cast(u8, kind));
+      }
+      case Token::Kind::TAB:
+      case Token::Kind::NO_PRINT: {
+        return x;
+      }
+      default: {
+        return screen.put(x, y, t, cast(u8, kind));
+      }
+    }
+  }
 
-    if (!lines.buf.ptr[k].tokenized) {
-      lines.buf.ptr[k].tokenize(&token_kind_map);
+  // Returns tokens of line k with text s, line is lexed only if
+  // its tokens are not cached
+  method TokenList* line_tokens(usz k, nord::LexState st, str s) noexcept {
+    var TokenList* tokens = tokens_cache.find(k, st);
+    if (tokens != nil) {
+      return tokens;
     }
+    return tokens_cache.put(&token_kind_map, k, st, s);
+  }
 
-    var TextLine line = lines.buf.ptr[k];
+  // Lex lines on pages around viewport which are not cached yet, so that
+  // scrolling to them does not wait on lexer
+  method void prefetch_tokens() noexcept {
+    const usz span = cast(usz, token_cache_pages) * cast(usz, vrows);
 
-    for (usz i = 0; i < line.tokens.buf.len; i += 1) {
-      var Token tok = line.tokens.buf.ptr[i];
+    // pages are visited from top to bottom, thus window of line states
+    // stays continuous across viewport
+    var usz top = 0;
+    if (vy > span) {
+      top = vy - span;
+    }
+    for (usz k = top; k < vy; k += 1) {
+      const nord::LexState st = line_start_state(k);
+      if (tokens_cache.find(k, st) == nil) {
+        tokens_cache.put(&token_kind_map, k, st, doc.line(k, &line_buf));
+      }
+    }
 
-      if (tok.kind == Token::Kind::SPACE) {
-        term_buf.write_repeat(cast(usz, tok.val), ' ');
-      } else {
-        change_text_color(style[cast(usz, tok.kind)]);
-        term_buf.write(tok.lit);
+    const usz bot = cast(usz, vy) + cast(usz, vrows);
+    for (usz k = bot; k < bot + span && doc.has_line(k); k += 1) {
+      const nord::LexState st = line_start_state(k);
+      if (tokens_cache.find(k, st) == nil) {
+        tokens_cache.put(&token_kind_map, k, st, doc.line(k, &line_buf));
       }
     }
   }
 
+  method nord::LexState line_start_state(usz k) noexcept {
+    return line_states.at(&token_kind_map, &doc, &line_buf, k);
+  }
+
+  // Update tokens of line under cursor after its bytes at [pos, pos + removed)
+  // were replaced by inserted number of bytes
+  method void relex_line_at_cursor(usz pos, usz removed, usz inserted) noexcept {
+    const usz line_index = vy + ty;
+    const nord::LexState st = line_start_state(line_index);
+    const str s = doc.line(line_index, &line_buf);
+    cursor_tokens.relex(&token_kind_map, s, line_index, st, pos, removed, inserted);
+    tokens_cache.invalidate(line_index);
+
+    if (line_states.update_end(&token_kind_map, &doc, &line_buf, line_index,
+                               cursor_tokens.end)) {
+      // edit opened or closed multiline construct, lines below
+      // change their look as well
+      full_viewport_upd_flag = true;
+    }
+  }
+
+  // Update lexer states after edit which changed line k and inserted (d > 0)
+  // or removed (d < 0) lines right after it
+  method void relex_lines(usz k, isz d) noexcept {
+    cursor_tokens.invalidate();
+    tokens_cache.shift(k, d);
+    line_states.update(&token_kind_map, &doc, &line_buf, k, d);
+  }
+
   method void redraw_line_at_cursor() noexcept {
-    term_buf.hide_cursor();
-    term_buf.clear_line_at_cursor();
-    term_buf.change_cursor_position(0, cy);
+    const u32 line_index = vy + ty;
+    draw_gutter(ty, line_index + 1);
+    draw_line(ty, line_index);
+  }
 
-    const u32 line_index = vy + cy;
-    draw_gutter(line_index + 1);
-    draw_line(line_index, 100);
+  // Document offset of a byte under cursor
+  method usz cursor_offset() noexcept {
+    const usz line_index = vy + ty;
+    return doc.line_start(line_index) + vx + tx;
   }
 
   method void insert_at_cursor(u8 x) noexcept {
-    const usz line_index = vy + ty;
-    const usz insert_index = vx + tx;
-    lines.buf.ptr[line_index].insert(insert_index, x);
+    const usz pos = vx + tx;
+    doc.insert(cursor_offset(), x);
+    relex_line_at_cursor(pos, 0, 1);
 
     // move cursor to next column after inserting a character
     tx += 1;
 
     redraw_line_at_cursor();
-    update_cursor_position();
-    term_buf.show_cursor();
-    term_buf.flush();
+    update_window();
   }
 
   method void delete_at_cursor() noexcept {
     const usz line_index = vy + ty;
     const usz remove_index = vx + tx;
-    lines.buf.ptr[line_index].remove(remove_index);
+    if (remove_index >= current_line_length()) {
+      if (!doc.has_line(line_index + 1)) {
+        return;
+      }
+
+      // join next line with current one by removing line break
+      const usz end = doc.line_end(line_index);
+      doc.remove(end, doc.line_start(line_index + 1) - end);
+      relex_lines(line_index, -1);
+
+      // lines below current one move up by one row
+      if (ty + 1 < vrows) {
+        screen.scroll(&term_buf, ty + 1, vrows, 1);
+      }
+      full_viewport_upd_flag = true;
+      update_window();
+      return;
+    }
+
+    doc.remove(cursor_offset(), 1);
+    relex_line_at_cursor(remove_index, 1, 0);
     redraw_line_at_cursor();
-    sync_cursor_position();
-    term_buf.show_cursor();
-    term_buf.flush();
+    update_window();
   }
 
   method void backspace_at_cursor() noexcept {
@@ -929,39 +2052,44 @@ struct Editor {
         return;
       }
 
+      // remove line break between previous and current lines
+      const usz end = doc.line_end(line_index - 1);
       const u32 prev_line_length =
-          cast(u32, lines.buf.ptr[line_index - 1].content().len);
-      var str text = lines.buf.ptr[line_index].content();
-      lines.buf.ptr[line_index - 1].append(text);
-      lines.buf.ptr[line_index].free();
-      lines.remove(line_index);
+          cast(u32, end - doc.line_start(line_index - 1));
+      doc.remove(end, doc.line_start(line_index) - end);
+      relex_lines(line_index - 1, -1);
 
-      move_cursor_up();
+      if (ty == 0) {
+        // merged line takes the top row, rows below it stay in place
+        vy -= 1;
+      } else {
+        // lines starting from current one move up by one row
+        screen.scroll(&term_buf, ty, vrows, 1);
+        ty -= 1;
+      }
       tx = prev_line_length;
 
       full_viewport_upd_flag = true;
       return;
     }
 
-    const u32 remove_index = cursor_index - 1;
-    lines.buf.ptr[line_index].remove(remove_index);
+    doc.remove(cursor_offset() - 1, 1);
+    relex_line_at_cursor(cursor_index - 1, 1, 0);
 
     // move cursor to previous column after backspacing a character
     tx -= 1;
 
     redraw_line_at_cursor();
-    term_buf.show_cursor();
   }
 
   method void split_line_at_cursor() noexcept {
-    const usz line_index = vy + ty;
-    const usz split_index = vx + tx;
+    doc.insert(cursor_offset(), '\n');
+    relex_lines(vy + ty, 1);
 
-    lines.insert(
-        line_index + 1,
-        TextLine(lines.buf.ptr[line_index].content().slice_from(split_index)));
-
-    lines.buf.ptr[line_index].crop(split_index);
+    // lines below current one move down by one row
+    if (ty + 1 < vrows) {
+      screen.scroll(&term_buf, ty + 1, vrows, -1);
+    }
 
     ty += 1;
     tx = 0;
@@ -975,7 +2103,7 @@ struct Editor {
 
   method u32 current_line_length() noexcept {
     const u32 line_index = vy + ty;
-    return cast(u32, lines.buf.ptr[line_index].content().len);
+    return cast(u32, doc.line_length(line_index));
   }
 
   method void move_cursor_up_line_end() noexcept {
@@ -984,6 +2112,9 @@ struct Editor {
   }
 
   method void move_cursor_down_line_start() noexcept {
+    if (!doc.has_line(vy + ty + 1)) {
+      return;
+    }
     move_cursor_down();
     tx = 0;
   }
@@ -992,15 +2123,25 @@ struct Editor {
     if (vy == 0) {
       return;
     }
-    vy -= 1;
-    full_viewport_upd_flag = true;
+    scroll_viewport(vy - 1);
   }
 
   method void move_viewport_down() noexcept {
-    if (vy + ty >= lines.len() - 1) {
+    if (!doc.has_line(vy + ty + 1)) {
       return;
     }
-    vy += 1;
+    scroll_viewport(vy + 1);
+  }
+
+  // Move viewport to start from line y. Contents of terminal screen which
+  // remain visible are moved via scrolling instead of being drawn again
+  method void scroll_viewport(u32 y) noexcept {
+    const i32 d = cast(i32, y) - cast(i32, vy);
+    if (d != 0) {
+      screen.scroll(&term_buf, 0, vrows, d);
+    }
+
+    vy = y;
     full_viewport_upd_flag = true;
   }
 
@@ -1032,6 +2173,9 @@ struct Editor {
   }
 
   method void move_cursor_down() noexcept {
+    if (!doc.has_line(vy + ty + 1)) {
+      return;
+    }
     if (ty >= vrows - 1) {
       move_viewport_down();
       return;
@@ -1041,7 +2185,11 @@ struct Editor {
 
   method void move_cursor_top() noexcept { ty = 0; }
 
-  method void move_cursor_bot() noexcept { ty = vrows - 1; }
+  // Places cursor at the bottom row or at the last line of document if
+  // it ends above bottom row
+  method void move_cursor_bot() noexcept {
+    ty = cast(u32, doc.clamp_line_count(vy + vrows)) - vy - 1;
+  }
 
   method void jump_viewport_up() noexcept {
     if (vy == 0) {
@@ -1049,24 +2197,27 @@ struct Editor {
     }
 
     if (vy < viewport_page_stride) {
-      vy = 0;
+      scroll_viewport(0);
     } else {
-      vy -= viewport_page_stride;
+      scroll_viewport(vy - viewport_page_stride);
     }
-    full_viewport_upd_flag = true;
   }
 
   method void jump_viewport_down() noexcept {
-    if (vy + ty >= lines.len() - 1) {
+    if (!doc.has_line(vy + ty + 1)) {
       return;
     }
 
-    if (vy + vrows + viewport_page_stride > lines.len() - 1) {
-      vy = cast(u32, lines.len()) - vrows;
+    if (!doc.has_line(vy + vrows + viewport_page_stride)) {
+      // whole document is indexed at this point, thus line count is cheap
+      const u32 n = cast(u32, doc.line_count());
+      if (n > vy + vrows) {
+        scroll_viewport(n - vrows);
+      }
+      ty = min(ty, n - vy - 1);
     } else {
-      vy += viewport_page_stride;
+      scroll_viewport(vy + viewport_page_stride);
     }
-    full_viewport_upd_flag = true;
   }
 
   method void update_cursor_position() noexcept {
@@ -1082,23 +2233,51 @@ struct Editor {
 
   method void update_window() noexcept {
     if (full_viewport_upd_flag) {
-      clear_window();
       draw_text();
       full_viewport_upd_flag = false;
     }
-    update_cursor_position();
+    present();
+  }
+
+  // Switch to colors from theme and draw entire screen again
+  method void load_theme(chunk<Color> theme) noexcept {
+    palette.load(theme);
+    screen.invalidate();
 
+    full_viewport_upd_flag = true;
+    update_window();
+  }
+
+  // Output changes made to screen since previous frame and place
+  // cursor at its current position
+  method void present() noexcept {
+    term_buf.hide_cursor();
+    screen.render(&term_buf);
+    update_cursor_position();
+    term_buf.show_cursor();
     term_buf.flush();
   }
 
-  method void clear_window() noexcept {
-    term_buf.reset();
+  // Called when no input arrived during read timeout. Spends idle time
+  // on lexing lines around viewport and extending line index and lexer
+  // states of the document
+  method void idle() noexcept {
+    prefetch_tokens();
+    doc.index_ahead(idle_index_size);
 
+    if (line_states.extend(&token_kind_map, &doc, &line_buf, idle_states_lines)) {
+      // states of lines on screen were guessed wrong
+      full_viewport_upd_flag = true;
+      update_window();
+    }
+  }
+
+  method void clear_window() noexcept {
     term_buf.write(macro_static_str("\x1b[2J"));  // clear terminal screen
     term_buf.write(
         macro_static_str("\x1b[H"));  // position cursor at the top-left corner
 
-    term_buf.flush();
+    screen.reset_front();
   }
 };
 
@@ -1112,6 +2291,7 @@ fn internal Editor::Key read_key_input() noexcept {
     isz num_bytes_read = read(stdin_fd, &c, 1);
     if ((num_bytes_read == -1 && errno != EAGAIN) || num_bytes_read == 0) {
       // read timed out, no input was given
+      e.idle();
       continue;
     }
 
@@ -1270,66 +2450,11 @@ fn internal void handle_key_input(Editor::Key k) noexcept {
   e.update_window();
 }
 
-// Adds elements to map one by one until all elements are
-// added or map is unable to hold next element
-//
-// Returns true if all elements were successfully added
-// to map. When true is returned function guarantees that
-// number of supplied literals equals resulting map.len
-//
-// Returns false as soon as at least one element was not
-// successfully added. In this case number of elements
-// actually stored inside a map is unpredictable
-fn bool populate_flat_map(FlatMap& map, chunk<Token> literals) noexcept {
-  for (usz i = 0; i < literals.len; i += 1) {
-    const Token tok = literals.ptr[i];
-    const bool ok = map.add(tok.lit, tok.kind);
-
-    if (!ok) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
-// Allocates a map of specified (cap) size on the heap and
-// picks a special seed for map hashing function which allows
-// to store all strings from literals chunk in map without
-// collisions
-//
-// Argument cap must be a power of 2. Argument mask must correspond
-// to that power with respective number of 1's in lower bits.
-// Number of supplied literals must be less than specified capacity.
-// It is recommended to pick capacity approximately five times
-// greater than number of literals
-fn FlatMap fit_into_flat_map(usz cap,
-                             u64 mask,
-                             chunk<Token> literals) noexcept {
-  //
-  var FlatMap map = FlatMap(cap, mask, 0);
-
-  for (u64 j = 0; j < 100000; j += 1) {
-    const bool ok = populate_flat_map(map, literals);
-
-    if (ok) {
-      return map;
-    }
-
-    map.clear();
-  }
-
-  map.free();
-  return FlatMap();
-}
-
 fn i32 main(i32 argc, u8** argv) noexcept {
   lg.init(macro_static_str("log.log"));
   lg.info(macro_static_str("nord start"));
   // lg.flush();
 
-  populate_flat_map(token_kind_map,
-                    chunk<Token>(cast(Token*, static_literals_table), 59));
   if (argc < 2) {
     e.init();
   } else {
@@ -0,0 +1,117 @@
+using namespace coven;
+
+// Largest size of memory region used in benchmark
+internal const uarch bench_max_size = 1 << 26;
+
+// Total number of bytes processed for each size. Small sizes are
+// repeated many times to get stable measurements
+internal const uarch bench_total_bytes = 1 << 28;
+
+internal const uarch bench_min_rounds = 4;
+
+// Shift between source and destination in overlapping moves, as
+// when inserting a small element into a buffer
+internal const uarch bench_move_shift = 8;
+
+enum struct BenchOp : u8 {
+  Copy,
+  Move,
+  Fill,
+};
+
+fn internal inline void clobber() noexcept {
+  asm volatile("" : : : "memory");
+}
+
+// Returns average number of cycles taken by one operation of n bytes
+fn internal u64 measure(BenchOp op, bool libc, u8* src, u8* dst, uarch n) noexcept {
+  var uarch rounds = bench_total_bytes / n;
+  if (rounds < bench_min_rounds) {
+    rounds = bench_min_rounds;
+  }
+
+  const u64 start = time::clock();
+  for (uarch i = 0; i < rounds; i += 1) {
+    switch (op) {
+      case BenchOp::Copy: {
+        if (libc) {
+          memcpy(dst, src, n);
+        } else {
+          mem::copy(src, dst, n);
+        }
+        break;
+      }
+      case BenchOp::Move: {
+        if (libc) {
+          memmove(src + bench_move_shift, src, n);
+        } else {
+          mem::move(src, src + bench_move_shift, n);
+        }
+        break;
+      }
+      case BenchOp::Fill: {
+        if (libc) {
+          memset(dst, cast(i32, i), n);
+        } else {
+          mem::fill(dst, cast(u8, i), n);
+        }
+        break;
+      }
+      default: {
+        unreachable();
+      }
+    }
+    clobber();
+  }
+  const u64 end = time::clock();
+
+  return (end - start) / rounds;
+}
+
+// Width of table column in output
+internal const uarch bench_column_width = 10;
+
+// Write number right-aligned in table column
+fn internal void column(fmt::Buffer* buf, u64 x) noexcept {
+  var u8 digits[24] dirty;
+  const uarch n = fmt::dec(mc(digits, sizeof(digits)), x);
+  buf->write_repeat(bench_column_width - n, ' ');
+  buf->write(digits, n);
+}
+
+// Compares mem::copy, mem::move and mem::fill against their libc
+// counterparts for sizes from 1 byte to 64 MiB. Reported numbers are
+// cycles per operation
+fn i32 main() noexcept {
+  var mc src = mem::alloc(bench_max_size + bench_move_shift);
+  var mc dst = mem::alloc(bench_max_size);
+  src.fill(1);
+  dst.fill(2);
+
+  var u8 scratch[256] dirty;
+  var fmt::Buffer buf = fmt::Buffer(scratch, sizeof(scratch));
+
+  buf.write(static_string("     bytes      copy      libc      move      libc      fill      libc"));
+  buf.lf();
+  os::stdout.print(buf.head());
+
+  for (uarch n = 1; n <= bench_max_size; n <<= 1) {
+    buf.reset();
+    column(&buf, n);
+
+    const BenchOp ops[] = {BenchOp::Copy, BenchOp::Move, BenchOp::Fill};
+    for (uarch k = 0; k < 3; k += 1) {
+      for (uarch j = 0; j < 2; j += 1) {
+        column(&buf, measure(ops[k], j != 0, src.ptr, dst.ptr, n));
+      }
+    }
+
+    buf.lf();
+    os::stdout.print(buf.head());
+    os::stdout.flush();
+  }
+
+  mem::free(src);
+  mem::free(dst);
+  return 0;
+}
@@ -428,6 +428,79 @@ method usz Token::fmt(mc c) noexcept {
   }
 }
 
+// Words with special meaning, other words are lexed as identifiers
+internal constexpr cont::StaticPair<Token::WordSpec> word_literals[] = {
+    {"var", {Token::Kind::Keyword, cast(u8, Token::Keyword::Var)}},
+    {"const", {Token::Kind::Keyword, cast(u8, Token::Keyword::Const)}},
+    {"struct", {Token::Kind::Keyword, cast(u8, Token::Keyword::Struct)}},
+    {"enum", {Token::Kind::Keyword, cast(u8, Token::Keyword::Enum)}},
+    {"fn", {Token::Kind::Keyword, cast(u8, Token::Keyword::Fn)}},
+    {"method", {Token::Kind::Keyword, cast(u8, Token::Keyword::Method)}},
+    {"let", {Token::Kind::Keyword, cast(u8, Token::Keyword::Let)}},
+    {"des", {Token::Kind::Keyword, cast(u8, Token::Keyword::Des)}},
+    {"for", {Token::Kind::Keyword, cast(u8, Token::Keyword::For)}},
+    {"while", {Token::Kind::Keyword, cast(u8, Token::Keyword::While)}},
+    {"switch", {Token::Kind::Keyword, cast(u8, Token::Keyword::Switch)}},
+    {"if", {Token::Kind::Keyword, cast(u8, Token::Keyword::If)}},
+    {"else", {Token::Kind::Keyword, cast(u8, Token::Keyword::Else)}},
+    {"do", {Token::Kind::Keyword, cast(u8, Token::Keyword::Do)}},
+    {"return", {Token::Kind::Keyword, cast(u8, Token::Keyword::Return)}},
+    {"case", {Token::Kind::Keyword, cast(u8, Token::Keyword::Case)}},
+    {"default", {Token::Kind::Keyword, cast(u8, Token::Keyword::Default)}},
+    {"continue", {Token::Kind::Keyword, cast(u8, Token::Keyword::Continue)}},
+    {"break", {Token::Kind::Keyword, cast(u8, Token::Keyword::Break)}},
+    {"typedef", {Token::Kind::Keyword, cast(u8, Token::Keyword::Typedef)}},
+    {"namespace", {Token::Kind::Keyword, cast(u8, Token::Keyword::Namespace)}},
+    {"template", {Token::Kind::Keyword, cast(u8, Token::Keyword::Template)}},
+    {"typename", {Token::Kind::Keyword, cast(u8, Token::Keyword::Typename)}},
+    {"internal", {Token::Kind::Keyword, cast(u8, Token::Keyword::Internal)}},
+    {"global", {Token::Kind::Keyword, cast(u8, Token::Keyword::Global)}},
+    {"dirty", {Token::Kind::Keyword, cast(u8, Token::Keyword::Dirty)}},
+    {"constexpr", {Token::Kind::Keyword, cast(u8, Token::Keyword::Constexpr)}},
+    {"inline", {Token::Kind::Keyword, cast(u8, Token::Keyword::Inline)}},
+    {"never", {Token::Kind::Keyword, cast(u8, Token::Keyword::Never)}},
+
+    {"sizeof", {Token::Kind::Builtin, cast(u8, Token::Builtin::Sizeof)}},
+    {"cast", {Token::Kind::Builtin, cast(u8, Token::Builtin::Cast)}},
+    {"u8", {Token::Kind::Builtin, cast(u8, Token::Builtin::U8)}},
+    {"i8", {Token::Kind::Builtin, cast(u8, Token::Builtin::I8)}},
+    {"u16", {Token::Kind::Builtin, cast(u8, Token::Builtin::U16)}},
+    {"i16", {Token::Kind::Builtin, cast(u8, Token::Builtin::I16)}},
+    {"u32", {Token::Kind::Builtin, cast(u8, Token::Builtin::U32)}},
+    {"i32", {Token::Kind::Builtin, cast(u8, Token::Builtin::I32)}},
+    {"u64", {Token::Kind::Builtin, cast(u8, Token::Builtin::U64)}},
+    {"i64", {Token::Kind::Builtin, cast(u8, Token::Builtin::I64)}},
+    {"u128", {Token::Kind::Builtin, cast(u8, Token::Builtin::U128)}},
+    {"i128", {Token::Kind::Builtin, cast(u8, Token::Builtin::I128)}},
+    {"usz", {Token::Kind::Builtin, cast(u8, Token::Builtin::Usz)}},
+    {"isz", {Token::Kind::Builtin, cast(u8, Token::Builtin::Isz)}},
+    {"f32", {Token::Kind::Builtin, cast(u8, Token::Builtin::F32)}},
+    {"f64", {Token::Kind::Builtin, cast(u8, Token::Builtin::F64)}},
+    {"f128", {Token::Kind::Builtin, cast(u8, Token::Builtin::F128)}},
+    {"bool", {Token::Kind::Builtin, cast(u8, Token::Builtin::Bool)}},
+    {"rune", {Token::Kind::Builtin, cast(u8, Token::Builtin::Rune)}},
+    {"mc", {Token::Kind::Builtin, cast(u8, Token::Builtin::MC)}},
+    {"bb", {Token::Kind::Builtin, cast(u8, Token::Builtin::BB)}},
+    {"str", {Token::Kind::Builtin, cast(u8, Token::Builtin::Str)}},
+    {"cstr", {Token::Kind::Builtin, cast(u8, Token::Builtin::Cstr)}},
+    {"chunk", {Token::Kind::Builtin, cast(u8, Token::Builtin::Chunk)}},
+    {"buffer", {Token::Kind::Builtin, cast(u8, Token::Builtin::Buffer)}},
+    {"error", {Token::Kind::Builtin, cast(u8, Token::Builtin::Error)}},
+    {"nil", {Token::Kind::Builtin, cast(u8, Token::Builtin::Nil)}},
+    {"void", {Token::Kind::Builtin, cast(u8, Token::Builtin::Void)}},
+    {"true", {Token::Kind::Builtin, cast(u8, Token::Builtin::True)}},
+    {"false", {Token::Kind::Builtin, cast(u8, Token::Builtin::False)}},
+    {"must", {Token::Kind::Builtin, cast(u8, Token::Builtin::Must)}},
+    {"unreachable", {Token::Kind::Builtin, cast(u8, Token::Builtin::Unreachable)}},
+    {"panic", {Token::Kind::Builtin, cast(u8, Token::Builtin::Panic)}},
+    {"nop_use", {Token::Kind::Builtin, cast(u8, Token::Builtin::NopUse)}},
+};
+
+typedef cont::StaticMapOf<word_literals> WordMap;
+
+internal constexpr WordMap word_map = WordMap(word_literals);
+
+
 internal const usz max_token_byte_length = 1 << 10;
 
 internal const usz max_small_token_byte_length = 23;
@@ -444,14 +517,13 @@ struct Lexer {
   Pos pos;
 
   // for detecting word tokens with special meaning:
-  //  - directives
   //  - keywords
   //  - builtins
-  container::FlatMap<Token::WordSpec>* map;
+  const WordMap* map;
 
   // Memory arena that is used to allocate space for
   // token literals
-  mem::Arena* arena;
+  mem::ChainArena* arena;
 
   // next byte read index
   u32 i;
@@ -478,8 +550,8 @@ struct Lexer {
   // lexer reached end of input
   bool eof;
 
-  let Lexer(mem::Arena* a,
-            container::FlatMap<Token::WordSpec>* m,
+  let Lexer(mem::ChainArena* a,
+            const WordMap* m,
             str t) noexcept
       : text(t),
         map(m),
@@ -647,11 +719,12 @@ struct Lexer {
       return Token(p, Token::Illegal::LengthOverflow);
     }
 
-    // TODO: add special tokens detection
-    // const FlatMap::Item item = map->get(w);
-    // if (item.ok) {
-    //   return Token(item.value, w);
-    // }
+    const WordMap::Item item = map->get(w);
+    if (item.ok) {
+      var Token tok = Token(p, item.value.kind);
+      tok.lit = Token::Literal(cast(u64, item.value.subkind));
+      return tok;
+    }
 
     return identifier(p, w);
   }
@@ -1031,8 +1104,8 @@ fn void lex_file(str filename) noexcept {
     exit(1);
   }
 
-  var mem::Arena arena = mem::Arena(mem::alloc(1 << 26));
-  var Lexer lx = Lexer(&arena, nil, rr.data);
+  var mem::ChainArena arena = mem::ChainArena(rr.data.len);
+  var Lexer lx = Lexer(&arena, &word_map, rr.data);
 
   dump_tokens(1, lx);
 }
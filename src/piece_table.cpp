@@ -0,0 +1,770 @@
+namespace nord {
+
+// Original text ranges of at least this size are indexed by several threads
+internal const usz parallel_index_threshold = 1 << 23;
+
+// Minimal amount of text scanned by a single indexing thread
+internal const usz min_index_task_size = 1 << 22;
+
+internal const usz max_index_threads = 32;
+
+// Part of original text scanned for newlines by a separate thread
+struct IndexTask {
+  str text;
+
+  // offset of text inside original
+  usz base;
+
+  // number of newlines inside text
+  usz count;
+
+  // where offsets of newlines (relative to original) must be stored
+  usz* out;
+};
+
+fn internal void count_breaks_task(void* arg) noexcept {
+  var IndexTask* t = cast(IndexTask*, arg);
+  t->count = coven::mem::count_byte(t->text, '\n');
+}
+
+fn internal void locate_breaks_task(void* arg) noexcept {
+  var IndexTask* t = cast(IndexTask*, arg);
+  const coven::mem::ScanResult r = coven::mem::index_byte(t->text, '\n', chunk<usz>(t->out, t->count));
+  for (usz i = 0; i < r.n; i += 1) {
+    t->out[i] += t->base;
+  }
+}
+
+// Execute all tasks in parallel. The first task is executed by calling
+// thread. If thread cannot be spawned its task is executed by calling
+// thread as well
+fn internal void run_index_tasks(IndexTask* tasks, usz n, coven::os::ThreadEntry entry) noexcept {
+  var coven::os::Thread threads[max_index_threads];
+  for (usz i = 1; i < n; i += 1) {
+    const coven::os::SpawnResult r = coven::os::spawn(&threads[i], entry, &tasks[i]);
+    if (r.is_err()) {
+      entry(&tasks[i]);
+    }
+  }
+
+  entry(&tasks[0]);
+
+  for (usz i = 1; i < n; i += 1) {
+    coven::os::join(&threads[i]);
+  }
+}
+
+// Text document stored as a sequence of pieces. Each piece is a slice of
+// one of two buffers:
+//
+//  - original: text of the file as it was loaded, never modified
+//    and never copied
+//  - add: append-only buffer which receives all inserted text
+//
+// Pieces are kept in a treap ordered by their position in document. Each
+// tree node also stores total number of bytes and newlines in its subtree,
+// thus insertion, deletion and line lookup cost O(log n) where n is the
+// number of pieces, regardless of file size
+//
+// Original text is indexed lazily. Only its prefix up to indexing frontier
+// is scanned for newlines and placed into the tree, the rest of it (tail)
+// is implicitly appended after the last tree piece. Tail is never edited,
+// all operations first move the frontier far enough to cover document
+// region they touch. Thus loading a file does not scan it and memory used
+// by line index grows only with the portion of text that has been visited
+struct PieceTable {
+  enum struct Source : u8 {
+    Original = 0,
+    Add,
+  };
+
+  struct Node {
+    // offset of piece first byte inside its source buffer
+    usz start;
+
+    // number of bytes in piece
+    usz len;
+
+    // number of newline characters in piece
+    usz nl;
+
+    // number of bytes in subtree with root at this node
+    usz size;
+
+    // number of newline characters in subtree with root at this node
+    usz lines;
+
+    // child node indices, 0 means no child
+    u32 left;
+    u32 right;
+
+    // random treap priority, parent always has greater or equal
+    // priority than its children
+    u32 prio;
+
+    Source source;
+  };
+
+  // Pair of subtrees produced by split operation
+  struct Split {
+    // subtree with all bytes before split position
+    u32 left;
+
+    // subtree with all bytes starting from split position
+    u32 right;
+  };
+
+  // text of the file as it was loaded
+  str original;
+
+  // offsets of all newline characters inside indexed part of original text
+  DynBuffer<usz> breaks;
+
+  // indexing frontier, all bytes of original text before this offset
+  // are indexed and belong to the tree
+  usz indexed;
+
+  // append-only buffer for inserted text
+  DynBytesBuffer add;
+
+  // Tree nodes storage. Nodes reference each other by index, so
+  // the storage may be reallocated freely. Node with index 0 is
+  // a sentinel which represents an empty subtree
+  DynBuffer<Node> nodes;
+
+  // indices of removed nodes available for reuse
+  DynBuffer<u32> vacant;
+
+  // root node index
+  u32 root;
+
+  // state of pseudo-random generator for treap priorities
+  u32 seed;
+
+  // number of original text bytes indexed at once when line index
+  // must be extended to reach requested line or offset
+  static const usz index_chunk_size = 1 << 16;
+
+  let PieceTable() noexcept : original(str()), indexed(0), root(0), seed(0x9E3779B9) {}
+
+  method void init(str text) noexcept {
+    original = text;
+    indexed = 0;
+    root = 0;
+
+    breaks.reset();
+    add.reset();
+    nodes.reset();
+    vacant.reset();
+
+    // sentinel node for empty subtree
+    nodes.append(Node{
+        .start = 0,
+        .len = 0,
+        .nl = 0,
+        .size = 0,
+        .lines = 0,
+        .left = 0,
+        .right = 0,
+        .prio = 0,
+        .source = Source::Original,
+    });
+  }
+
+  // Total number of bytes in document
+  method usz size() noexcept { return at(root).size + (original.len - indexed); }
+
+  // Reports whether entire original text is indexed
+  method bool is_indexed() noexcept { return indexed == original.len; }
+
+  // Number of lines in document. Every newline starts a new line, thus
+  // newline at the end of document is followed by an empty last line
+  // and empty document consists of one empty line
+  //
+  // Indexes entire document, use has_line or clamp_line_count where
+  // possible
+  method usz line_count() noexcept {
+    index_all();
+    return at(root).lines + 1;
+  }
+
+  // Reports whether document contains line k. Indexes document only as
+  // far as needed to answer
+  method bool has_line(usz k) noexcept {
+    index_lines(k);
+    return k <= at(root).lines;
+  }
+
+  // Returns min(n, line_count()) without indexing the whole document
+  method usz clamp_line_count(usz n) noexcept {
+    if (n == 0) {
+      return 0;
+    }
+    if (has_line(n - 1)) {
+      return n;
+    }
+    return line_count();
+  }
+
+  // Returns document offset of the first byte in line k. Line right
+  // after the last one starts at the end of document
+  method usz line_start(usz k) noexcept {
+    if (k == 0) {
+      return 0;
+    }
+    index_lines(k);
+
+    const usz nl = at(root).lines;
+    if (k > nl) {
+      must(k == nl + 1);
+      return size();
+    }
+    return newline_offset(k) + 1;
+  }
+
+  // Returns document offset right after the last byte of line k
+  // content. Trailing newline and carriage return characters are not
+  // considered part of line content
+  method usz line_end(usz k) noexcept {
+    const usz start = line_start(k);
+    index_lines(k + 1);
+
+    var usz end = size();
+    if (k < at(root).lines) {
+      end = newline_offset(k + 1);
+    }
+
+    if (end > start && byte_at(end - 1) == '\r') {
+      end -= 1;
+    }
+    return end;
+  }
+
+  // Number of bytes in line k content
+  method usz line_length(usz k) noexcept { return line_end(k) - line_start(k); }
+
+  // Returns content of line k. If line is stored inside a single piece
+  // returned string is a view into that piece, otherwise line content is
+  // assembled inside supplied scratch buffer
+  //
+  // Returned string is valid until the next modification of document or
+  // scratch buffer
+  method str line(usz k, DynBytesBuffer* scratch) noexcept {
+    const usz start = line_start(k);
+    const usz end = line_end(k);
+    if (start == end) {
+      return str();
+    }
+
+    // locate piece which contains first byte of line
+    var u32 t = root;
+    var usz base = 0;
+    while (t != 0) {
+      const Node n = at(t);
+      const usz left_size = at(n.left).size;
+      if (start < base + left_size) {
+        t = n.left;
+        continue;
+      }
+
+      base += left_size;
+      if (start < base + n.len) {
+        if (end <= base + n.len) {
+          return text(n).slice(start - base, end - base);
+        }
+        break;
+      }
+
+      base += n.len;
+      t = n.right;
+    }
+
+    scratch->reset();
+    collect(root, 0, start, end, scratch);
+    return scratch->head();
+  }
+
+  // Insert text at specified document offset
+  method void insert(usz pos, str s) noexcept {
+    if (s.is_nil()) {
+      return;
+    }
+    must(pos <= size());
+
+    index_to(pos);
+
+    const usz add_start = add.head().len;
+    add.write(s);
+    const usz nl = count_add_newlines(add_start, s.len);
+
+    const Split p = split(root, pos);
+    if (extend(p.left, Source::Add, add_start, s.len, nl)) {
+      root = merge(p.left, p.right);
+      return;
+    }
+
+    const u32 t = create(Source::Add, add_start, s.len);
+    root = merge(merge(p.left, t), p.right);
+  }
+
+  method void insert(usz pos, u8 x) noexcept { insert(pos, mc(&x, 1)); }
+
+  // Remove n bytes starting from specified document offset
+  method void remove(usz pos, usz n) noexcept {
+    if (n == 0) {
+      return;
+    }
+    must(pos + n <= size());
+    index_to(pos + n);
+
+    const Split a = split(root, pos);
+    const Split b = split(a.right, n);
+    release(b.left);
+    root = merge(a.left, b.right);
+  }
+
+  // Write entire document to supplied writer piece by piece
+  //
+  // Writer must implement method write(mc c) which returns result
+  // with is_err() method
+  //
+  // Returns false if any write fails
+  template <typename W>
+  method bool write_to(W& w) noexcept {
+    if (!write_subtree(root, w)) {
+      return false;
+    }
+    if (is_indexed()) {
+      return true;
+    }
+    return !w.write(original.slice(indexed, original.len)).is_err();
+  }
+
+  // Index at least n more bytes of original text. Intended to be called
+  // when there is nothing else to do, so that later lookups in far regions
+  // of document do not have to scan a lot of text at once
+  //
+  // Returns false if there is nothing left to index
+  method bool index_ahead(usz n) noexcept {
+    if (is_indexed()) {
+      return false;
+    }
+    index_next(n);
+    return true;
+  }
+
+  method void free() noexcept {
+    breaks.free();
+    add.free();
+    nodes.free();
+    vacant.free();
+  }
+
+  method Node& at(u32 t) noexcept { return nodes.buf.ptr[t]; }
+
+  method str text(Node n) noexcept {
+    if (n.source == Source::Original) {
+      return original.slice(n.start, n.start + n.len);
+    }
+    return add.head().slice(n.start, n.start + n.len);
+  }
+
+  // Scan next n bytes of original text after indexing frontier and
+  // append them to the tree as a piece
+  method void index_next(usz n) noexcept {
+    const usz start = indexed;
+    const usz end = min(start + n, original.len);
+    if (start == end) {
+      return;
+    }
+
+    const usz nl_before = breaks.len();
+    if (end - start >= parallel_index_threshold) {
+      scan_breaks_parallel(start, end);
+    } else {
+      scan_breaks(start, end);
+    }
+    indexed = end;
+
+    const usz nl = breaks.len() - nl_before;
+    if (extend(root, Source::Original, start, end - start, nl)) {
+      return;
+    }
+    root = merge(root, create(Source::Original, start, end - start));
+  }
+
+  // Append offsets of newlines inside original text range [start, end)
+  // to breaks
+  method void scan_breaks(usz start, usz end) noexcept {
+    var usz pos = start;
+    while (pos < end) {
+      if (breaks.buf.rem() == 0) {
+        // expect lines to be 32 bytes long on average
+        breaks.grow(((end - pos) >> 5) + 16);
+      }
+
+      var buffer<usz>& b = breaks.buf;
+      const coven::mem::ScanResult r = coven::mem::index_byte(
+          original.slice(pos, end), '\n', chunk<usz>(b.ptr + b.len, b.rem()));
+      for (usz i = 0; i < r.n; i += 1) {
+        b.ptr[b.len + i] += pos;
+      }
+      b.len += r.n;
+      pos += r.pos;
+    }
+  }
+
+  // Same as scan_breaks, but range is split into parts which are scanned
+  // by several threads. Each part is scanned twice: first pass counts
+  // newlines, prefix sum of counts gives each part its place inside breaks,
+  // second pass writes offsets there directly. Counting first also lets
+  // breaks grow exactly once, which matters for large ranges
+  method void scan_breaks_parallel(usz start, usz end) noexcept {
+    const usz len = end - start;
+    const usz n = max(cast(usz, 1), min(min(coven::os::cpu_count(), max_index_threads),
+                                        len / min_index_task_size));
+
+    var IndexTask tasks[max_index_threads] dirty;
+    const usz step = len / n;
+    for (usz i = 0; i < n; i += 1) {
+      const usz a = start + i * step;
+      const usz b = (i + 1 == n) ? end : a + step;
+      tasks[i] = IndexTask{
+          .text = original.slice(a, b),
+          .base = a,
+          .count = 0,
+          .out = nil,
+      };
+    }
+    run_index_tasks(tasks, n, count_breaks_task);
+
+    var usz total = 0;
+    for (usz i = 0; i < n; i += 1) {
+      total += tasks[i].count;
+    }
+    if (breaks.buf.rem() < total) {
+      breaks.grow(total - breaks.buf.rem());
+    }
+
+    var usz* out = breaks.buf.ptr + breaks.buf.len;
+    for (usz i = 0; i < n; i += 1) {
+      tasks[i].out = out;
+      out += tasks[i].count;
+    }
+    run_index_tasks(tasks, n, locate_breaks_task);
+    breaks.buf.len += total;
+  }
+
+  // Move indexing frontier until tree contains at least pos bytes
+  //
+  // Amount of text indexed at each step doubles, thus far jumps are
+  // resolved in a few large (possibly parallel) scans
+  method void index_to(usz pos) noexcept {
+    var usz step = index_chunk_size;
+    while (at(root).size < pos && !is_indexed()) {
+      index_next(step);
+      step <<= 1;
+    }
+  }
+
+  // Move indexing frontier until tree contains at least n newlines
+  method void index_lines(usz n) noexcept {
+    var usz step = index_chunk_size;
+    while (at(root).lines < n && !is_indexed()) {
+      index_next(step);
+      step <<= 1;
+    }
+  }
+
+  method void index_all() noexcept { index_next(original.len - indexed); }
+
+  // Returns index of the first newline inside original text which
+  // offset is greater or equal to specified one
+  method usz lower_break(usz offset) noexcept {
+    var usz lo = 0;
+    var usz hi = breaks.len();
+    while (lo < hi) {
+      const usz mid = lo + ((hi - lo) >> 1);
+      if (breaks.buf.ptr[mid] < offset) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  method usz count_add_newlines(usz start, usz len) noexcept {
+    return coven::mem::count_byte(add.head().slice(start, start + len), '\n');
+  }
+
+  method usz count_newlines(Source source, usz start, usz len) noexcept {
+    if (source == Source::Original) {
+      return lower_break(start + len) - lower_break(start);
+    }
+    return count_add_newlines(start, len);
+  }
+
+  // Returns offset of k-th (starting from 1) newline inside
+  // the piece relative to piece start
+  method usz piece_newline(Node n, usz k) noexcept {
+    must(k != 0 && k <= n.nl);
+
+    if (n.source == Source::Original) {
+      return breaks.buf.ptr[lower_break(n.start) + k - 1] - n.start;
+    }
+
+    const str s = text(n);
+    for (usz i = 0; i < s.len; i += 1) {
+      if (s.ptr[i] == '\n') {
+        k -= 1;
+        if (k == 0) {
+          return i;
+        }
+      }
+    }
+
+    unreachable();
+  }
+
+  // Returns document offset of k-th (starting from 1) newline
+  method usz newline_offset(usz k) noexcept {
+    must(k != 0 && k <= at(root).lines);
+
+    var u32 t = root;
+    var usz base = 0;
+    while (t != 0) {
+      const Node n = at(t);
+      const Node left = at(n.left);
+      if (k <= left.lines) {
+        t = n.left;
+        continue;
+      }
+
+      k -= left.lines;
+      base += left.size;
+      if (k <= n.nl) {
+        return base + piece_newline(n, k);
+      }
+
+      k -= n.nl;
+      base += n.len;
+      t = n.right;
+    }
+
+    unreachable();
+  }
+
+  method u8 byte_at(usz pos) noexcept {
+    must(pos < size());
+
+    if (pos >= at(root).size) {
+      return original.ptr[indexed + (pos - at(root).size)];
+    }
+
+    var u32 t = root;
+    while (t != 0) {
+      const Node n = at(t);
+      const usz left_size = at(n.left).size;
+      if (pos < left_size) {
+        t = n.left;
+        continue;
+      }
+
+      pos -= left_size;
+      if (pos < n.len) {
+        return text(n).ptr[pos];
+      }
+
+      pos -= n.len;
+      t = n.right;
+    }
+
+    unreachable();
+  }
+
+  method u32 next_prio() noexcept {
+    // xorshift32
+    var u32 x = seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seed = x;
+    return x;
+  }
+
+  method u32 create(Source source, usz start, usz len) noexcept {
+    const Node n = Node{
+        .start = start,
+        .len = len,
+        .nl = count_newlines(source, start, len),
+        .size = len,
+        .lines = 0,
+        .left = 0,
+        .right = 0,
+        .prio = next_prio(),
+        .source = source,
+    };
+
+    var u32 t dirty;
+    if (vacant.len() != 0) {
+      t = vacant.buf.ptr[vacant.len() - 1];
+      vacant.remove(vacant.len() - 1);
+      at(t) = n;
+    } else {
+      t = cast(u32, nodes.len());
+      nodes.append(n);
+    }
+
+    at(t).lines = n.nl;
+    return t;
+  }
+
+  // Recalculate subtree totals of a node from its children
+  method void update(u32 t) noexcept {
+    var Node& n = at(t);
+    const Node left = at(n.left);
+    const Node right = at(n.right);
+
+    n.size = left.size + n.len + right.size;
+    n.lines = left.lines + n.nl + right.lines;
+  }
+
+  // Split subtree into two: the first one contains exactly pos bytes,
+  // the second one contains the rest. Piece which contains split
+  // position is cut in two
+  method Split split(u32 t, usz pos) noexcept {
+    if (t == 0) {
+      return Split{.left = 0, .right = 0};
+    }
+
+    const usz left_size = at(at(t).left).size;
+    if (pos <= left_size) {
+      const Split p = split(at(t).left, pos);
+      at(t).left = p.right;
+      update(t);
+      return Split{.left = p.left, .right = t};
+    }
+
+    pos -= left_size;
+    const usz len = at(t).len;
+    if (pos >= len) {
+      const Split p = split(at(t).right, pos - len);
+      at(t).right = p.left;
+      update(t);
+      return Split{.left = t, .right = p.right};
+    }
+
+    // split position is strictly inside this node piece
+    const u32 tail = create(at(t).source, at(t).start + pos, len - pos);
+
+    var Node& n = at(t);
+    const u32 right = n.right;
+    n.len = pos;
+    n.nl -= at(tail).nl;
+    n.right = 0;
+    update(t);
+
+    return Split{.left = t, .right = merge(tail, right)};
+  }
+
+  // Merge two subtrees. All bytes of the first subtree must precede
+  // all bytes of the second one
+  method u32 merge(u32 a, u32 b) noexcept {
+    if (a == 0) {
+      return b;
+    }
+    if (b == 0) {
+      return a;
+    }
+
+    if (at(a).prio > at(b).prio) {
+      at(a).right = merge(at(a).right, b);
+      update(a);
+      return a;
+    }
+
+    at(b).left = merge(a, at(b).left);
+    update(b);
+    return b;
+  }
+
+  // Grow the last piece of subtree by n bytes if that piece ends exactly
+  // where newly appended text starts in the same source buffer. This keeps
+  // number of pieces low when text is typed sequentially or original text
+  // is indexed chunk by chunk
+  method bool extend(u32 t, Source source, usz start, usz n, usz nl) noexcept {
+    if (t == 0) {
+      return false;
+    }
+
+    if (at(t).right != 0) {
+      const bool ok = extend(at(t).right, source, start, n, nl);
+      if (ok) {
+        update(t);
+      }
+      return ok;
+    }
+
+    var Node& node = at(t);
+    if (node.source != source || node.start + node.len != start) {
+      return false;
+    }
+
+    node.len += n;
+    node.nl += nl;
+    update(t);
+    return true;
+  }
+
+  // Put all nodes of subtree into vacant list
+  method void release(u32 t) noexcept {
+    if (t == 0) {
+      return;
+    }
+
+    release(at(t).left);
+    release(at(t).right);
+    vacant.append(t);
+  }
+
+  // Copy document bytes from range [a, b) which belong to subtree
+  // into buffer. Argument base is document offset of subtree first byte
+  method void collect(u32 t, usz base, usz a, usz b, DynBytesBuffer* buf) noexcept {
+    if (t == 0 || a >= b || base >= b || base + at(t).size <= a) {
+      return;
+    }
+
+    const Node n = at(t);
+    const usz left_size = at(n.left).size;
+    collect(n.left, base, a, b, buf);
+
+    const usz start = base + left_size;
+    const usz end = start + n.len;
+    if (start < b && a < end) {
+      const usz from = max(a, start) - start;
+      const usz to = min(b, end) - start;
+      buf->write(text(n).slice(from, to));
+    }
+
+    collect(n.right, end, a, b, buf);
+  }
+
+  template <typename W>
+  method bool write_subtree(u32 t, W& w) noexcept {
+    if (t == 0) {
+      return true;
+    }
+
+    const Node n = at(t);
+    if (!write_subtree(n.left, w)) {
+      return false;
+    }
+    if (n.len != 0 && w.write(text(n)).is_err()) {
+      return false;
+    }
+    return write_subtree(n.right, w);
+  }
+};
+
+}  // namespace nord